@@ -0,0 +1,75 @@
+#include "aggregate.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/* Same scale as the card sensors */
+#define AGGREGATE_TEMPERATURE_SCALE -4
+
+namespace phosphor
+{
+namespace mpSOC
+{
+aggregateSensor::aggregateSensor(sdbusplus::bus::bus& bus,
+                                 const std::string& path,
+                                 const aggregateConfig& config) :
+    aggregateIfaces(bus, path.c_str(), true),
+    config(config)
+{
+    scale(AGGREGATE_TEMPERATURE_SCALE, true);
+}
+
+void aggregateSensor::update(const std::vector<cardReading>& cards)
+{
+    size_t count = 0;
+    int64_t highest = 0;
+    double sum = 0;
+    double weights = 0;
+
+    for (size_t i = 0; i < config.cards.size(); i++)
+    {
+        auto card = std::find_if(cards.begin(), cards.end(),
+                                 [this, i](const cardReading& c) {
+                                     return c.index == config.cards[i];
+                                 });
+        if (card == cards.end() || !card->present || !card->functional)
+        {
+            continue;
+        }
+        auto w = (config.type == aggregateConfig::function::weighted)
+                     ? config.weights[i]
+                     : 1.0;
+        highest = (count == 0) ? card->value : std::max(highest, card->value);
+        sum += w * card->value;
+        weights += w;
+        count++;
+    }
+
+    /* Weights of the cards left are all zero, nothing to weigh */
+    if (count == 0 || (config.type != aggregateConfig::function::max &&
+                       weights <= 0))
+    {
+        if (announced)
+        {
+            functional(false);
+        }
+        return;
+    }
+
+    auto result = (config.type == aggregateConfig::function::max)
+                      ? highest
+                      : static_cast<int64_t>(std::llround(sum / weights));
+    if (!announced)
+    {
+        /* Initial properties go out with the single InterfacesAdded */
+        value(result, true);
+        functional(true, true);
+        emit_object_added();
+        announced = true;
+        return;
+    }
+    value(result);
+    functional(true);
+}
+}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "config_parser.hpp"
+#include "readings.hpp"
+
+#include <string>
+#include <vector>
+#include <xyz/openbmc_project/Sensor/Value/server.hpp>
+#include <xyz/openbmc_project/State/Decorator/OperationalStatus/server.hpp>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+using aggregateIfaces = sdbusplus::server::object::object<
+    sdbusplus::xyz::openbmc_project::Sensor::server::Value,
+    sdbusplus::xyz::openbmc_project::State::Decorator::server::
+        OperationalStatus>;
+
+/** @class aggregateSensor
+ *  @brief Sensor.Value derived from the readings of a group of cards, e.g.
+ *         the hottest card of a fan zone.
+ *
+ *  Recomputed once per poll cycle from the cards that have a reading.
+ *  The object is announced with its first value, Functional goes false
+ *  while none of the cards has a reading and Value is then stale. Value
+ *  has the unit and scale of the card sensors.
+ */
+class aggregateSensor : public aggregateIfaces
+{
+  public:
+    aggregateSensor() = delete;
+    aggregateSensor(const aggregateSensor&) = delete;
+    aggregateSensor& operator=(const aggregateSensor&) = delete;
+    aggregateSensor(aggregateSensor&&) = delete;
+    aggregateSensor& operator=(aggregateSensor&&) = delete;
+    virtual ~aggregateSensor() = default;
+
+    /** @brief Constructs aggregateSensor, announced on D-Bus by the first
+     *         update() with a reading
+     *
+     * @param[in] bus    - Handle to system dbus
+     * @param[in] path   - The dbus path of the sensor
+     * @param[in] config - Function and cards of the sensor
+     */
+    aggregateSensor(sdbusplus::bus::bus& bus, const std::string& path,
+                    const aggregateConfig& config);
+
+    /** @brief Recompute Value from the readings of a poll cycle */
+    void update(const std::vector<cardReading>& cards);
+
+    const aggregateConfig& getConfig() const
+    {
+        return config;
+    }
+
+  private:
+    aggregateConfig config;
+    bool announced = false;
+};
+}
+}
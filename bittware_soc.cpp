@@ -1,15 +1,15 @@
 #include "config.h"
 #include "bittware_soc.hpp"
+#include "ratelimit.hpp"
 #include "sdbusplus.hpp"
 #include "smbus.hpp"
 
+#include <chrono>
 #include <iostream>
 
 #define IO_EXPANDER_SLAVE_ADDR 0x39
 #define IO_EXPANDER_DIR_MASK (0x01 << 4)
 #define IO_EXPANDER_VALUE_MASK (0x01 << 4)
-#define IO_EXPANDER_COMMAND_1 0x01
-#define IO_EXPANDER_COMMAND_3 0x03
 #define I2C_VPD_SLAVE_ADDR 0x50
 
 namespace phosphor
@@ -25,64 +25,167 @@ static const std::unordered_map<std::string, keywordInfo>
         {"FN", std::make_tuple("FieldReplaceUnit", BITTWARE_SOC_STATUS_IFACE, 7)},
 };
 
-bittwareSOC::bittwareSOC(uint8_t index, sdbusplus::bus::bus& bus, bittwareConfig config) :
-    index(index), bus(bus), config(config)
+bittwareSOC::bittwareSOC(uint8_t index, sdbusplus::bus::bus& bus, bittwareConfig config,
+                         const backendConfig& backend) :
+    index(index), bus(bus), config(config), backend(backend),
+    expander(config.busID, IO_EXPANDER_SLAVE_ADDR)
 {
-    init();
 }
 
-void bittwareSOC::read()
+void bittwareSOC::read(bool overBudget)
 {
     if (present)
     {
-        tmpSensor->getTemp();
+        auto now = std::chrono::steady_clock::now();
+        if (!overBudget && now - expanderVerified >=
+            std::chrono::seconds(EXPANDER_VERIFY_SECONDS))
+        {
+            expanderVerified = now;
+            if (!expander.verify())
+            {
+                ratelimit::error("Restoring IO expander registers",
+                                 config.busID, IO_EXPANDER_SLAVE_ADDR, 0);
+                expander.repair();
+            }
+        }
+
+        functional = tmpSensor->getTemp(urgency() > 0);
+        if (functional)
+        {
+            lastReadTime =
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count();
+            if (burst)
+            {
+                burst->add(lastReadTime, tmpSensor->lastReading());
+            }
+        }
+        /* A card failing its reads goes back to its normal rate too */
+        if (burst)
+        {
+            burst->expire(std::chrono::steady_clock::now());
+        }
     }
 }
 
-void bittwareSOC::createInventory()
+bool bittwareSOC::watchAlarms(const sdeventplus::Event& event,
+                              std::function<void()> onAlarm)
 {
-    using Properties =
-        std::map<std::string, sdbusplus::message::variant<std::string, bool>>;
-    using Interfaces = std::map<std::string, Properties>;
+    if (tmpSensor && !alarmsWatched)
+    {
+        alarmsWatched = tmpSensor->watchAlarms(event, std::move(onAlarm));
+    }
+    return alarmsWatched;
+}
 
-    std::string inventoryPath;
-    std::map<sdbusplus::message::object_path, Interfaces> obj;
+static bool sameBurst(const burstConfig& a, const burstConfig& b)
+{
+    return a.enabled == b.enabled && a.level == b.level &&
+           a.levelSet == b.levelSet && a.slope == b.slope &&
+           a.interval == b.interval && a.duration == b.duration &&
+           a.preTrigger == b.preTrigger;
+}
 
-    inventoryPath = "/system/chassis/motherboard/BittwareSOC" + std::to_string(index);
-    obj = {{
-        inventoryPath,
-        {{ITEM_IFACE, {}}, {BITTWARE_SOC_STATUS_IFACE, {}}, {ASSET_IFACE, {}}},
-    }};
-    phosphor::mpSOC::util::SDBusPlus::CallMethod(bus, INVENTORY_BUSNAME,
-        INVENTORY_NAMESPACE, INVENTORY_MANAGER_IFACE, "Notify", obj);
+void bittwareSOC::setBurst(const burstConfig& burstSettings)
+{
+    if (!present || !burstSettings.enabled)
+    {
+        burst.reset();
+        return;
+    }
+    if (burst && sameBurst(burst->getConfig(), burstSettings))
+    {
+        return;
+    }
+    /* The interface must be gone before it's added again */
+    burst.reset();
+    auto path = std::string(BITTWARE_SOC_CONTROL_PATH) + std::to_string(index);
+    burst = std::make_unique<burstCapture>(bus, path.c_str(), burstSettings);
+}
+
+uint64_t bittwareSOC::pollInterval() const
+{
+    if (bursting())
+    {
+        return burst->getConfig().interval;
+    }
+    return (alarmsWatched && config.alarmInterval > 0) ? config.alarmInterval
+                                                        : config.pollInterval;
+}
+
+void bittwareSOC::reconfigure(const bittwareConfig& newConfig)
+{
+    config = newConfig;
+    if (tmpSensor)
+    {
+        tmpSensor->setDeadband(config.deadband);
+        tmpSensor->setSensorThreshold(config.criticalHigh, config.criticalLow,
+            config.maxValue, config.minValue,
+            config.warningHigh, config.warningLow);
+    }
+}
+
+uint8_t bittwareSOC::urgency() const
+{
+    return (present && functional) ? tmpSensor->urgency(config.margin) : 0;
+}
+
+cardReading bittwareSOC::reading() const
+{
+    return {index, (tmpSensor) ? tmpSensor->value() : 0, lastReadTime,
+            present, functional};
+}
+
+checkpoint::card bittwareSOC::checkpointState() const
+{
+    checkpoint::card state;
+    state.index = index;
+    state.busID = config.busID;
+    state.present = present;
+    state.expanderDirection = expander.direction();
+    state.expanderOutput = expander.output();
+    state.fingerprint = fingerprint;
+    state.vpdData = vpdData;
+    state.value = (tmpSensor) ? tmpSensor->value() : 0;
+    state.timestamp = lastReadTime;
+    state.functional = functional;
+    return state;
 }
 
-void bittwareSOC::setInventoryProperties(
-            const bool& present, const vpd& vpdDev)
+void bittwareSOC::createInventory(
+    const bool& present, const std::map<std::string, std::string>& vpdData)
 {
-    std::string path = BITTWARE_SOC_INVENTORY_PATH + std::to_string(index);
-    util::SDBusPlus::setProperty(bus, INVENTORY_BUSNAME,
-        path, ITEM_IFACE, "Present", present);
+    inventory = {
+        {ITEM_IFACE, {{"Present", present}}},
+        {ASSET_IFACE, {}},
+        {BITTWARE_SOC_STATUS_IFACE, {}},
+    };
     for (auto it = supportedKeywords.begin(); it != supportedKeywords.end(); it++)
     {
-        auto data = vpdDev.vpdData.find(it->first);
+        auto data = vpdData.find(it->first);
+        auto& properties = inventory[std::get<1>(it->second)];
 
-        if (data != vpdDev.vpdData.end())
+        if (data != vpdData.end())
         {
-            util::SDBusPlus::setProperty(bus, INVENTORY_BUSNAME, path,
-                std::get<1>(it->second), std::get<0>(it->second),
-                data->second.substr(0, std::get<2>(it->second)));
+            properties[std::get<0>(it->second)] =
+                data->second.substr(0, std::get<2>(it->second));
         }
         else
         {
             /* Keyword not found, filled with empty string */
-            util::SDBusPlus::setProperty(bus, INVENTORY_BUSNAME, path,
-                std::get<1>(it->second), std::get<0>(it->second),
-                std::string());
+            properties[std::get<0>(it->second)] = std::string();
         }
     }
 }
 
+void bittwareSOC::addInventoryObject(inventoryObjects& objs) const
+{
+    std::string inventoryPath =
+        "/system/chassis/motherboard/BittwareSOC" + std::to_string(index);
+    objs.emplace(inventoryPath, inventory);
+}
+
 /** @brief Make sure smbus on 250 SoC has been enabled */
 bool bittwareSOC::smbusEnable(int busID, uint8_t addr)
 {
@@ -96,18 +199,23 @@ bool bittwareSOC::smbusEnable(int busID, uint8_t addr)
         return false;
     }
 
-    auto exist = bus.smbusCheckSlave(busID, addr);
-    if (exist)
+    bus.smbusWaitUrgent(busID);
+    /* Shadows are loaded once, nobody may write the expander in between */
+    if (bus.smbusLock(busID) < 0)
+    {
+        bus.smbusClose(busID);
+        return false;
+    }
+    auto exist = expander.present();
+    if (exist && !expander.load())
     {
-        uint8_t direction = bus.GetSmbusCmdByte(busID, addr, IO_EXPANDER_COMMAND_3);
-        direction &= ~(IO_EXPANDER_DIR_MASK);
-        res = bus.SetSmbusCmdByte(busID, addr, IO_EXPANDER_COMMAND_3, direction);
-        if (res >= 0)
+        std::cerr << "Failed to read IO expander.\n";
+    }
+    else if (exist)
+    {
+        if (expander.setDirection(IO_EXPANDER_DIR_MASK, false))
         {
-            uint8_t value = bus.GetSmbusCmdByte(busID, addr, IO_EXPANDER_COMMAND_1);
-            value |= IO_EXPANDER_VALUE_MASK;
-            res = bus.SetSmbusCmdByte(busID, addr, IO_EXPANDER_COMMAND_1, value);
-            if (res >= 0)
+            if (expander.setOutput(IO_EXPANDER_VALUE_MASK, true))
             {
                 auto vpdExist = bus.smbusCheckSlave(busID, I2C_VPD_SLAVE_ADDR);
                 auto sensorExist = bus.smbusCheckSlave(busID, TMP431_SLAVE_ADDR);
@@ -127,25 +235,109 @@ bool bittwareSOC::smbusEnable(int busID, uint8_t addr)
     {
         std::cout << "Bittware " << (int)config.index << " not present." << std::endl;
     }
+    bus.smbusUnlock(busID);
 
     bus.smbusClose(busID);
 
     return enabled;
 }
 
-void bittwareSOC::init()
+bool bittwareSOC::verifyExpander(int busID, uint8_t addr)
+{
+    bool verified = false;
+    auto bus = phosphor::smbus::Smbus();
+
+    if (bus.smbusInit(busID) == -1)
+    {
+        return false;
+    }
+
+    bus.smbusWaitUrgent(busID);
+    if (bus.smbusLock(busID) < 0)
+    {
+        bus.smbusClose(busID);
+        return false;
+    }
+    expander.restore(saved->expanderDirection, saved->expanderOutput);
+    if (expander.verify() && !(expander.direction() & IO_EXPANDER_DIR_MASK) &&
+        (expander.output() & IO_EXPANDER_VALUE_MASK))
+    {
+        auto vpdExist = bus.smbusCheckSlave(busID, I2C_VPD_SLAVE_ADDR);
+        auto sensorExist = bus.smbusCheckSlave(busID, TMP431_SLAVE_ADDR);
+        verified = (vpdExist & sensorExist);
+    }
+    bus.smbusUnlock(busID);
+
+    bus.smbusClose(busID);
+
+    return verified;
+}
+
+void bittwareSOC::probe(timeline& startup)
 {
-    createInventory();
+    /* Cards absent before are probed in full, there's nothing to skip */
+    if (saved && saved->present)
+    {
+        timeline::scope phase(startup, index, "verify");
+        present = verifyExpander(config.busID, IO_EXPANDER_SLAVE_ADDR);
+        if (present)
+        {
+            warm = true;
+            return;
+        }
+        std::cout << "Bittware " << (int)index
+                  << " changed since last run, probing again" << std::endl;
+    }
+    timeline::scope phase(startup, index, "smbusEnable");
     present = smbusEnable(config.busID, IO_EXPANDER_SLAVE_ADDR);
-    auto vpdDev = (present) ? vpd(config.busID, I2C_VPD_SLAVE_ADDR) : vpd();
-    setInventoryProperties(present, vpdDev);
+}
+
+void bittwareSOC::readVPD(timeline& startup)
+{
+    if (present && saved && saved->present)
+    {
+        timeline::scope phase(startup, index, "vpdVerify");
+        if (vpd::verify(config.busID, I2C_VPD_SLAVE_ADDR, backend,
+                        saved->fingerprint))
+        {
+            vpdData = saved->vpdData;
+            fingerprint = saved->fingerprint;
+            vpdRestored = true;
+            createInventory(present, vpdData);
+            return;
+        }
+    }
+    timeline::scope phase(startup, index, "vpd");
+    auto vpdDev = (present) ? vpd(config.busID, I2C_VPD_SLAVE_ADDR, backend) : vpd();
+    vpdData = vpdDev.vpdData;
+    fingerprint = vpdDev.fingerprint();
+    createInventory(present, vpdData);
+}
+
+void bittwareSOC::publish(timeline& startup)
+{
     if (present)
     {
+        timeline::scope phase(startup, index, "sensor");
         auto path = std::string(BITTWARE_SOC_OBJ_PATH + std::to_string(index));
-        tmpSensor = std::make_shared<sensor>(bus, path, config.busID);
+        tmpSensor = std::make_shared<sensor>(bus, path, config.busID, backend);
         tmpSensor->setSensorThreshold(config.criticalHigh, config.criticalLow,
             config.maxValue, config.minValue,
-            config.warningHigh, config.warningLow);
+            config.warningHigh, config.warningLow, true);
+        tmpSensor->setDeadband(config.deadband);
+        /* Last reading of the previous run until the card is polled */
+        if (warm && saved->functional)
+        {
+            tmpSensor->restore(saved->value);
+            functional = true;
+            lastReadTime = saved->timestamp;
+        }
+        tmpSensor->emit_object_added();
+        auto controlPath = std::string(BITTWARE_SOC_CONTROL_PATH) +
+                           std::to_string(index);
+        control = std::make_unique<expanderControl>(
+            bus, controlPath.c_str(), expander, IO_EXPANDER_VALUE_MASK);
+        expanderVerified = std::chrono::steady_clock::now();
     }
 }
 }
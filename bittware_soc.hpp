@@ -1,11 +1,27 @@
+#pragma once
+
+#include "burst.hpp"
+#include "checkpoint.hpp"
+#include "expander_control.hpp"
+#include "io_expander.hpp"
 #include "vpd.hpp"
+#include "readings.hpp"
 #include "sensor.hpp"
+#include "timeline.hpp"
+
+#include <chrono>
+#include <optional>
 
 namespace phosphor
 {
 namespace mpSOC
 {
 using keywordInfo = std::tuple<std::string, std::string, uint8_t>;
+using inventoryProperties =
+    std::map<std::string, sdbusplus::message::variant<std::string, bool>>;
+using inventoryInterfaces = std::map<std::string, inventoryProperties>;
+using inventoryObjects =
+    std::map<sdbusplus::message::object_path, inventoryInterfaces>;
 
 /** @class bittwareSOC
  *  @brief bittwareSOC manager implementation.
@@ -24,25 +40,132 @@ class bittwareSOC
     {
         uint8_t index;
         uint8_t busID;
-        uint64_t criticalHigh;
-        uint64_t criticalLow;
-        uint64_t maxValue;
-        uint64_t minValue;
-        uint64_t warningHigh;
-        uint64_t warningLow;
+        int64_t criticalHigh;
+        int64_t criticalLow;
+        int64_t maxValue;
+        int64_t minValue;
+        int64_t warningHigh;
+        int64_t warningLow;
+        /** @brief Poll interval in milliseconds */
+        uint64_t pollInterval;
+        /** @brief Poll interval in milliseconds while the hwmon alarms of
+         *         the card are watched, 0 to keep pollInterval.
+         */
+        uint64_t alarmInterval;
+        /** @brief Minimum change in degrees C published to Value */
+        double deadband;
+        /** @brief Higher priority cards are read first */
+        uint8_t priority;
+        /** @brief Degrees C below warningHigh or criticalHigh from which
+         *         the card is read ahead of cards further from their limits
+         */
+        double margin;
     };
 
     /** @brief Constructs bittwareSOC
      *
      * @param[in] bus     - Handle to system dbus
      * @param[in] objPath - The dbus path of bittwareSOC
+     * @param[in] backend - Access path of the sensor and the EEPROM
+     */
+    bittwareSOC(uint8_t index, sdbusplus::bus::bus& bus, bittwareConfig config,
+                const backendConfig& backend);
+    /** @brief Bring the card up from the state of a previous run, probe()
+     *         and readVPD() only verify it. Call before probe().
+     */
+    void restoreFrom(const checkpoint::card& state)
+    {
+        saved = state;
+    }
+    /** @brief State to bring the card up from after a restart */
+    checkpoint::card checkpointState() const;
+    /** @brief Whether the inventory is the one published by the previous
+     *         run, it doesn't need to be sent again.
+     */
+    bool inventoryRestored() const
+    {
+        return vpdRestored;
+    }
+    /** @brief Detect the card, only touches I2C so it may run on a worker
+     *         thread.
+     *
+     * @param[in] startup - Timeline the probe phases are recorded to
      */
-    bittwareSOC(uint8_t index, sdbusplus::bus::bus& bus, bittwareConfig config);
-    void createInventory();
-    void setInventoryProperties(const bool& present, const vpd& vpdDev);
-    /** @brief Reading temperature of Bittware 250 SoC  */
-    void read();
-    bool present;
+    void probe(timeline& startup);
+    /** @brief Read the VPD of a probed card and build its inventory, only
+     *         touches I2C so it may run on a worker thread.
+     *
+     * @param[in] startup - Timeline the VPD phase is recorded to
+     */
+    void readVPD(timeline& startup);
+    /** @brief Create the D-Bus objects of a probed card, must run on the
+     *         thread owning the bus.
+     *
+     * @param[in] startup - Timeline the publish phases are recorded to
+     */
+    void publish(timeline& startup);
+    /** @brief Build the inventory object of this card from its VPD
+     *
+     * @param[in] present - Whether the card has been detected
+     * @param[in] vpdData - VPD keywords read from the card EEPROM
+     */
+    void createInventory(const bool& present,
+                         const std::map<std::string, std::string>& vpdData);
+    /** @brief Add this card's inventory object to a Notify request
+     *
+     * @param[in,out] objs - Object map passed to Inventory Manager Notify
+     */
+    void addInventoryObject(inventoryObjects& objs) const;
+    uint8_t getIndex() const
+    {
+        return index;
+    }
+    const bittwareConfig& getConfig() const
+    {
+        return config;
+    }
+    /** @brief Apply a new config to a running card, index and bus must be
+     *         unchanged.
+     */
+    void reconfigure(const bittwareConfig& newConfig);
+    /** @brief Reading temperature of Bittware 250 SoC
+     *
+     * @param[in] overBudget - The poll cycle ran out of its budget, the
+     *                         expander check waits for a later cycle
+     */
+    void read(bool overBudget = false);
+    /** @brief The card missed its reads, its reading isn't current */
+    void markStale()
+    {
+        functional = false;
+    }
+    /** @brief Get notified by the kernel when the card crosses warningHigh
+     *         or criticalHigh, needs the hwmon backend.
+     *
+     * @return Whether the alarms are watched
+     */
+    bool watchAlarms(const sdeventplus::Event& event,
+                     std::function<void()> onAlarm);
+    /** @brief Sample the card at a high rate around its transients, the
+     *         running burst is dropped if the config changed.
+     */
+    void setBurst(const burstConfig& burstSettings);
+    /** @brief Whether the card is to be read at the burst interval */
+    bool bursting() const
+    {
+        return burst && burst->active();
+    }
+    /** @brief Milliseconds between polls, alarmInterval once the alarms
+     *         are watched, the burst interval while a burst runs.
+     */
+    uint64_t pollInterval() const;
+    /** @brief How close the last reading is to the card limits, 2 near
+     *         criticalHigh, 1 near warningHigh, 0 otherwise.
+     */
+    uint8_t urgency() const;
+    /** @brief Latest reading of the card, as of the last read() */
+    cardReading reading() const;
+    bool present = false;
   private:
     uint8_t index;
     /** @brief sdbusplus bus client connection. */
@@ -50,9 +173,37 @@ class bittwareSOC
     /** @brief the temperature sensor on bittware SoC */
     std::shared_ptr<sensor> tmpSensor;
     bittwareConfig config;
-    /** @brief Set up initial configuration value of 250 SoC */
-    void init();
+    backendConfig backend;
+    /** @brief Whether crossings are notified by the kernel */
+    bool alarmsWatched = false;
+    /** @brief Whether the last read() got a temperature */
+    bool functional = false;
+    /** @brief Microseconds since epoch of the last successful read() */
+    uint64_t lastReadTime = 0;
+    /** @brief Item, Asset and Status properties published to inventory */
+    inventoryInterfaces inventory;
+    /** @brief Parsed VPD and its fingerprint, kept for the checkpoint */
+    std::map<std::string, std::string> vpdData;
+    vpdFingerprint fingerprint;
+    /** @brief IO expander gating the card SMBus, with shadow registers */
+    ioExpander expander;
+    /** @brief D-Bus control of the expander lines */
+    std::unique_ptr<expanderControl> control;
+    /** @brief Burst capture of the card, only while enabled */
+    std::unique_ptr<burstCapture> burst;
+    /** @brief Last time the expander registers were checked */
+    std::chrono::steady_clock::time_point expanderVerified;
+    /** @brief State of the previous run, if the card is warm restarted */
+    std::optional<checkpoint::card> saved;
+    /** @brief Whether the card was verified to be as it was saved */
+    bool warm = false;
+    /** @brief Whether the saved VPD has been verified and reused */
+    bool vpdRestored = false;
     bool smbusEnable(int busID, uint8_t addr);
+    /** @brief Check that the expander still holds the saved registers and
+     *         the card answers, instead of programming it again.
+     */
+    bool verifyExpander(int busID, uint8_t addr);
 };
 }
 }
\ No newline at end of file
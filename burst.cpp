@@ -0,0 +1,165 @@
+#include "config.h"
+#include "burst.hpp"
+
+#include <sdbusplus/message.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+/* Sensor.Value of the cards has scale -4 */
+#define BURST_VALUE_MULTIPLIER 10000
+/* Bounds the window whatever the interval and duration */
+#define BURST_MAX_SAMPLES 10000
+
+namespace phosphor
+{
+namespace mpSOC
+{
+const sdbusplus::vtable::vtable_t burstCapture::vtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("Active", "b", burstCapture::getActive,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::property("TriggerTime", "t",
+                                burstCapture::getTriggerTime,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::method("GetCapture", "", "a(tx)",
+                              burstCapture::getCapture),
+    sdbusplus::vtable::end()};
+
+burstCapture::burstCapture(sdbusplus::bus::bus& bus, const char* objPath,
+                           const burstConfig& config) :
+    config(config),
+    iface(bus, objPath, BITTWARE_SOC_BURST_IFACE, vtable, this)
+{
+}
+
+bool burstCapture::triggers(uint64_t timestamp, int64_t value) const
+{
+    if (ring.empty())
+    {
+        return false;
+    }
+    auto last = ring.back();
+    auto level =
+        static_cast<int64_t>(config.level * BURST_VALUE_MULTIPLIER);
+    if (config.levelSet && std::get<1>(last) < level && value >= level)
+    {
+        return true;
+    }
+    if (config.slope > 0 && timestamp > std::get<0>(last))
+    {
+        double rise = static_cast<double>(value - std::get<1>(last)) /
+                      BURST_VALUE_MULTIPLIER;
+        double seconds = (timestamp - std::get<0>(last)) * 1e-6;
+        return rise / seconds >= config.slope;
+    }
+    return false;
+}
+
+void burstCapture::add(uint64_t timestamp, int64_t value)
+{
+    if (running)
+    {
+        window.emplace_back(timestamp, value);
+        if (window.size() >= BURST_MAX_SAMPLES)
+        {
+            finish();
+        }
+        return;
+    }
+
+    if (config.enabled && triggers(timestamp, value))
+    {
+        running = true;
+        triggerTime = timestamp;
+        /* Wall clock steps mustn't stretch or cut the burst */
+        burstEnd = std::chrono::steady_clock::now() +
+                   std::chrono::milliseconds(config.duration);
+        window.assign(ring.begin(), ring.end());
+        window.emplace_back(timestamp, value);
+        ring.clear();
+        iface.property_changed("Active");
+        return;
+    }
+
+    /* One reading is kept for the triggers even without pre-trigger */
+    ring.emplace_back(timestamp, value);
+    while (ring.size() > std::max<size_t>(config.preTrigger, 1))
+    {
+        ring.pop_front();
+    }
+}
+
+void burstCapture::expire(std::chrono::steady_clock::time_point now)
+{
+    if (running && now >= burstEnd)
+    {
+        finish();
+    }
+}
+
+void burstCapture::finish()
+{
+    running = false;
+    capture.swap(window);
+    window.clear();
+    captureTime = triggerTime;
+    /* The last burst reading is the reference of the next trigger */
+    ring.push_back(capture.back());
+    iface.property_changed("Active");
+    iface.property_changed("TriggerTime");
+}
+
+int burstCapture::getActive(sd_bus*, const char*, const char*, const char*,
+                            sd_bus_message* reply, void* context,
+                            sd_bus_error*)
+{
+    auto self = static_cast<burstCapture*>(context);
+    try
+    {
+        sdbusplus::message::message(reply).append(self->running);
+    }
+    catch (const std::exception&)
+    {
+        return -EIO;
+    }
+    return 1;
+}
+
+int burstCapture::getTriggerTime(sd_bus*, const char*, const char*,
+                                 const char*, sd_bus_message* reply,
+                                 void* context, sd_bus_error*)
+{
+    auto self = static_cast<burstCapture*>(context);
+    try
+    {
+        sdbusplus::message::message(reply).append(self->captureTime);
+    }
+    catch (const std::exception&)
+    {
+        return -EIO;
+    }
+    return 1;
+}
+
+int burstCapture::getCapture(sd_bus_message* msg, void* context,
+                             sd_bus_error*)
+{
+    auto self = static_cast<burstCapture*>(context);
+    try
+    {
+        auto m = sdbusplus::message::message(msg);
+        auto reply = m.new_method_return();
+        reply.append(self->capture);
+        reply.method_return();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "GetCapture fail. ERROR = " << e.what() << std::endl;
+        return -EIO;
+    }
+
+    return 1;
+}
+}
+}
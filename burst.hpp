@@ -0,0 +1,133 @@
+#pragma once
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/interface.hpp>
+#include <sdbusplus/vtable.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <tuple>
+#include <vector>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+/** @brief Burst sampling around the thermal transients of a card */
+struct burstConfig
+{
+    bool enabled = false;
+    /** @brief A reading at or above level after one below it triggers,
+     *         in degrees C. Ignored unless levelSet.
+     */
+    double level = 0;
+    bool levelSet = false;
+    /** @brief A rise of at least slope degrees C per second between two
+     *         readings triggers, 0 to disable.
+     */
+    double slope = 0;
+    /** @brief Poll interval in milliseconds while the burst runs */
+    uint64_t interval = 100;
+    /** @brief Length of the burst in milliseconds */
+    uint64_t duration = 10000;
+    /** @brief Readings before the trigger kept in the capture */
+    uint32_t preTrigger = 60;
+};
+
+/** @class burstCapture
+ *  @brief Pre-trigger ring and burst window of one card.
+ *
+ *  Every reading of the card goes through add(). The last preTrigger
+ *  readings are kept in a ring. Once a reading crosses the level or the
+ *  slope, the card is read every interval for duration, then the ring and
+ *  the burst readings become the capture served on D-Bus and the card
+ *  goes back to its normal rate.
+ *
+ *  Active (b) tells whether a burst runs, TriggerTime (t) is the time in
+ *  microseconds since epoch of the trigger of the last capture and changes
+ *  once a new capture is complete. GetCapture() returns the readings of
+ *  the last capture as a(tx): timestamp and value, same unit and scale as
+ *  Sensor.Value.
+ */
+class burstCapture
+{
+  public:
+    burstCapture() = delete;
+    burstCapture(const burstCapture&) = delete;
+    burstCapture& operator=(const burstCapture&) = delete;
+    burstCapture(burstCapture&&) = delete;
+    burstCapture& operator=(burstCapture&&) = delete;
+    virtual ~burstCapture() = default;
+
+    /** @brief Constructs burstCapture
+     *
+     * @param[in] bus     - Handle to system dbus
+     * @param[in] objPath - The dbus path the interface is served on
+     * @param[in] config  - Triggers and window of the bursts
+     */
+    burstCapture(sdbusplus::bus::bus& bus, const char* objPath,
+                 const burstConfig& config);
+
+    /** @brief Account a reading of the card
+     *
+     * @param[in] timestamp - Microseconds since epoch of the reading
+     * @param[in] value     - Temperature, same unit and scale as
+     *                        Sensor.Value
+     */
+    void add(uint64_t timestamp, int64_t value);
+
+    /** @brief End the running burst once its duration is over, to be
+     *         called on every poll whether the reading succeeded or not
+     *
+     * @param[in] now - Current time of the monotonic clock
+     */
+    void expire(std::chrono::steady_clock::time_point now);
+
+    /** @brief Whether the card is to be read at the burst interval */
+    bool active() const
+    {
+        return running;
+    }
+
+    const burstConfig& getConfig() const
+    {
+        return config;
+    }
+
+  private:
+    using sample = std::tuple<uint64_t, int64_t>;
+
+    static int getActive(sd_bus* bus, const char* path,
+                         const char* interface, const char* property,
+                         sd_bus_message* reply, void* context,
+                         sd_bus_error* error);
+    static int getTriggerTime(sd_bus* bus, const char* path,
+                              const char* interface, const char* property,
+                              sd_bus_message* reply, void* context,
+                              sd_bus_error* error);
+    static int getCapture(sd_bus_message* msg, void* context,
+                          sd_bus_error* error);
+
+    static const sdbusplus::vtable::vtable_t vtable[];
+
+    /** @brief Whether a reading following the last one is a trigger */
+    bool triggers(uint64_t timestamp, int64_t value) const;
+    /** @brief Publish the window as the capture, back to the normal rate */
+    void finish();
+
+    burstConfig config;
+    /** @brief Readings before the trigger, oldest first */
+    std::deque<sample> ring;
+    /** @brief Window of the running burst, pre-trigger readings first */
+    std::vector<sample> window;
+    bool running = false;
+    uint64_t triggerTime = 0;
+    std::chrono::steady_clock::time_point burstEnd;
+    /** @brief Last complete capture */
+    std::vector<sample> capture;
+    uint64_t captureTime = 0;
+    sdbusplus::server::interface::interface iface;
+};
+}
+}
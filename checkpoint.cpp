@@ -0,0 +1,170 @@
+#include "checkpoint.hpp"
+#include "nlohmann/json.hpp"
+
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+/* Checkpoints of another layout are ignored, the cards come up cold */
+#define CHECKPOINT_VERSION 1
+
+namespace phosphor
+{
+namespace mpSOC
+{
+namespace checkpoint
+{
+uint64_t hash(const unsigned char* data, size_t length)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++)
+    {
+        h ^= data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/** @brief VPD values are raw bytes, JSON strings must be UTF-8 */
+static std::string toHex(const std::string& data)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (unsigned char c : data)
+    {
+        hex += digits[c >> 4];
+        hex += digits[c & 0x0f];
+    }
+    return hex;
+}
+
+static std::string fromHex(const std::string& hex)
+{
+    if (hex.size() % 2)
+    {
+        throw std::invalid_argument("odd length");
+    }
+    std::string data;
+    for (size_t i = 0; i < hex.size(); i += 2)
+    {
+        data += static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16));
+    }
+    return data;
+}
+
+std::map<uint8_t, card> load(const std::string& path)
+{
+    std::map<uint8_t, card> cards;
+
+    std::ifstream in(path);
+    if (!in.is_open())
+    {
+        return cards;
+    }
+    auto data = nlohmann::json::parse(in, nullptr, false);
+    if (data.is_discarded() || !data.is_object() ||
+        data.value("version", 0) != CHECKPOINT_VERSION)
+    {
+        std::cerr << "Ignoring unusable checkpoint " << path << std::endl;
+        return cards;
+    }
+
+    try
+    {
+        for (const auto& c : data.at("cards"))
+        {
+            card saved;
+            saved.index = c.at("index").get<uint8_t>();
+            saved.busID = c.at("bus").get<uint8_t>();
+            saved.present = c.at("present").get<bool>();
+            saved.expanderDirection = c.at("expanderDirection").get<uint8_t>();
+            saved.expanderOutput = c.at("expanderOutput").get<uint8_t>();
+            const auto& fp = c.at("fingerprint");
+            saved.fingerprint.offset = fp.at("offset").get<uint8_t>();
+            saved.fingerprint.length = fp.at("length").get<uint8_t>();
+            saved.fingerprint.hash = fp.at("hash").get<uint64_t>();
+            for (const auto& kw : c.at("vpd").items())
+            {
+                saved.vpdData[kw.key()] = fromHex(kw.value().get<std::string>());
+            }
+            saved.value = c.at("value").get<int64_t>();
+            saved.timestamp = c.at("timestamp").get<uint64_t>();
+            saved.functional = c.at("functional").get<bool>();
+            cards[saved.index] = saved;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Ignoring unusable checkpoint " << path << ": "
+                  << e.what() << std::endl;
+        cards.clear();
+    }
+
+    return cards;
+}
+
+bool save(const std::string& path, const std::vector<card>& cards)
+{
+    auto dir = path.substr(0, path.find_last_of('/'));
+    if (!dir.empty() && mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST)
+    {
+        std::cerr << "Failed to create " << dir << ": " << strerror(errno)
+                  << std::endl;
+        return false;
+    }
+
+    nlohmann::json data;
+    data["version"] = CHECKPOINT_VERSION;
+    data["cards"] = nlohmann::json::array();
+    for (const auto& c : cards)
+    {
+        nlohmann::json vpd = nlohmann::json::object();
+        for (const auto& kw : c.vpdData)
+        {
+            vpd[kw.first] = toHex(kw.second);
+        }
+        data["cards"].push_back({
+            {"index", c.index},
+            {"bus", c.busID},
+            {"present", c.present},
+            {"expanderDirection", c.expanderDirection},
+            {"expanderOutput", c.expanderOutput},
+            {"fingerprint",
+             {{"offset", c.fingerprint.offset},
+              {"length", c.fingerprint.length},
+              {"hash", c.fingerprint.hash}}},
+            {"vpd", vpd},
+            {"value", c.value},
+            {"timestamp", c.timestamp},
+            {"functional", c.functional},
+        });
+    }
+
+    auto tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << data.dump();
+        if (!out.good())
+        {
+            std::cerr << "Failed to write " << tmp << std::endl;
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) < 0)
+    {
+        std::cerr << "Failed to replace " << path << ": " << strerror(errno)
+                  << std::endl;
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+} // namespace checkpoint
+}
+}
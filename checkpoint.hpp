@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+/** @brief Identifies the VPD of a card without dumping the whole EEPROM,
+ *         a hash of the bytes of the serial number keyword.
+ */
+struct vpdFingerprint
+{
+    uint8_t offset = 0;
+    /** @brief 0 if the VPD has no serial number, it can't be verified */
+    uint8_t length = 0;
+    uint64_t hash = 0;
+};
+
+namespace checkpoint
+{
+/** @brief Runtime state of one card, enough to bring it up again without
+ *         repeating the full probe and VPD dump.
+ */
+struct card
+{
+    uint8_t index = 0;
+    uint8_t busID = 0;
+    bool present = false;
+    /** @brief IO expander direction and output registers last written */
+    uint8_t expanderDirection = 0;
+    uint8_t expanderOutput = 0;
+    vpdFingerprint fingerprint;
+    /** @brief Parsed VPD keywords */
+    std::map<std::string, std::string> vpdData;
+    /** @brief Last reading, same unit and scale as Sensor.Value */
+    int64_t value = 0;
+    /** @brief Microseconds since epoch of the last successful read */
+    uint64_t timestamp = 0;
+    bool functional = false;
+};
+
+/** @brief FNV-1a hash of a buffer */
+uint64_t hash(const unsigned char* data, size_t length);
+
+/** @brief Read the checkpoint left by a previous run
+ *
+ * @return Cards by index, empty if there's no usable checkpoint
+ */
+std::map<uint8_t, card> load(const std::string& path);
+
+/** @brief Replace the checkpoint, the file is swapped in by rename() so a
+ *         crash never leaves a partial one.
+ *
+ * @return false if the checkpoint couldn't be written
+ */
+bool save(const std::string& path, const std::vector<card>& cards);
+} // namespace checkpoint
+}
+}
@@ -0,0 +1,1156 @@
+#include "config.h"
+#include "config_parser.hpp"
+#include "nlohmann/json.hpp"
+
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <streambuf>
+#include <utility>
+
+#define MONITOR_INTERVAL_SECONDS 1
+/* Degrees C below warningHigh from which a card is read ahead of others */
+#define NEAR_LIMIT_MARGIN 5
+/* Readings kept before a burst trigger, per card */
+#define BURST_MAX_PRETRIGGER 10000
+/* Adapter timeout in milliseconds, the kernel counts it in 10ms units */
+#define BUS_TIMEOUT_MIN 10
+#define BUS_TIMEOUT_MAX 60000
+#define BUS_RETRIES_MAX 10
+/* Longest wait in milliseconds for the lock file, the poll loop waits too */
+#define BUS_LOCK_TIMEOUT_MAX 1000
+
+using Json = nlohmann::json;
+
+namespace phosphor
+{
+namespace mpSOC
+{
+namespace
+{
+using bittwareConfig = bittwareSOC::bittwareConfig;
+
+/** @class positionBuf
+ *  @brief Unbuffered stream buffer counting the lines and columns read
+ *         through it, the JSON lexer reads at most one character ahead.
+ */
+class positionBuf : public std::streambuf
+{
+  public:
+    explicit positionBuf(std::streambuf* src) : src(src)
+    {
+    }
+    size_t line = 1;
+    size_t column = 0;
+
+  protected:
+    int_type underflow() override
+    {
+        return src->sgetc();
+    }
+    int_type uflow() override
+    {
+        auto c = src->sbumpc();
+        if (c == '\n')
+        {
+            line++;
+            column = 0;
+        }
+        else if (c != traits_type::eof())
+        {
+            column++;
+        }
+        return c;
+    }
+
+  private:
+    std::streambuf* src;
+};
+
+/** @brief Threshold keys, a card inherits the defaults of the keys it
+ *         doesn't set.
+ */
+static const std::array<std::pair<const char*, int64_t bittwareConfig::*>, 6>
+    thresholdFields = {{
+        {"criticalHigh", &bittwareConfig::criticalHigh},
+        {"criticalLow", &bittwareConfig::criticalLow},
+        {"maxValue", &bittwareConfig::maxValue},
+        {"minValue", &bittwareConfig::minValue},
+        {"warningHigh", &bittwareConfig::warningHigh},
+        {"warningLow", &bittwareConfig::warningLow},
+    }};
+
+/* Bits of the polling keys in cardEntry::set, after the threshold keys */
+constexpr uint32_t intervalSet = 1 << thresholdFields.size();
+constexpr uint32_t deadbandSet = intervalSet << 1;
+constexpr uint32_t prioritySet = deadbandSet << 1;
+constexpr uint32_t marginSet = prioritySet << 1;
+constexpr uint32_t alarmIntervalSet = marginSet << 1;
+
+struct busEntry
+{
+    busPolicy policy;
+    bool busIDSet;
+    size_t line;
+    size_t column;
+};
+
+struct aggregateEntry
+{
+    aggregateConfig config;
+    bool functionSet;
+    size_t line;
+    size_t column;
+};
+
+struct cardEntry
+{
+    bittwareConfig config;
+    /** @brief Keys set by the card itself */
+    uint32_t set;
+    size_t line;
+    size_t column;
+};
+
+/** @class configHandler
+ *  @brief SAX handler filling daemonConfig as the file is streamed.
+ */
+class configHandler
+{
+  public:
+    configHandler(const std::string& path, const positionBuf& pos) :
+        path(path), pos(pos)
+    {
+        defaults = bittwareConfig{};
+        defaults.pollInterval = MONITOR_INTERVAL_SECONDS * 1000;
+        defaults.margin = NEAR_LIMIT_MARGIN;
+        result.telemetryPath = TELEMETRY_PATH;
+        result.metricsPath = METRICS_SOCKET_PATH;
+        result.sampleLogPath = SAMPLE_LOG_PATH;
+    }
+
+    bool null()
+    {
+        return scalar();
+    }
+
+    bool boolean(bool value)
+    {
+        if (skipDepth > 0)
+        {
+            return true;
+        }
+        if (top() == context::telemetry && currentKey == "enabled")
+        {
+            result.telemetryEnabled = value;
+            return true;
+        }
+        if (top() == context::metrics && currentKey == "enabled")
+        {
+            result.metricsEnabled = value;
+            return true;
+        }
+        if (top() == context::sampleLog && currentKey == "enabled")
+        {
+            result.sampleLogEnabled = value;
+            return true;
+        }
+        if (top() == context::burst && currentKey == "enabled")
+        {
+            result.burst.enabled = value;
+            return true;
+        }
+        if (top() == context::backend && currentKey == "alarmLimits")
+        {
+            result.backend.alarmLimits = value;
+            return true;
+        }
+        return scalar();
+    }
+
+    bool number_integer(Json::number_integer_t value)
+    {
+        return integer(value);
+    }
+
+    bool number_unsigned(Json::number_unsigned_t value)
+    {
+        if (skipDepth == 0 &&
+            value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+        {
+            return error("number out of range");
+        }
+        return integer(static_cast<int64_t>(value));
+    }
+
+    bool number_float(Json::number_float_t value, const Json::string_t&)
+    {
+        if (skipDepth > 0)
+        {
+            return true;
+        }
+        auto ctx = top();
+        if ((ctx == context::polling || ctx == context::cardPolling) &&
+            (currentKey == "deadband" || currentKey == "margin"))
+        {
+            return degrees(value);
+        }
+        if (ctx == context::aggregateWeights)
+        {
+            return weight(value);
+        }
+        if (ctx == context::burst &&
+            (currentKey == "level" || currentKey == "slope"))
+        {
+            return burstTrigger(value);
+        }
+        if (knownKey())
+        {
+            return error("expected an integer for \"" + currentKey + "\"");
+        }
+        return scalar();
+    }
+
+    bool string(Json::string_t& value)
+    {
+        if (skipDepth > 0)
+        {
+            return true;
+        }
+        if (top() == context::telemetry && currentKey == "path")
+        {
+            result.telemetryPath = value;
+            return true;
+        }
+        if (top() == context::metrics && currentKey == "path")
+        {
+            result.metricsPath = value;
+            return true;
+        }
+        if (top() == context::sampleLog && currentKey == "path")
+        {
+            result.sampleLogPath = value;
+            return true;
+        }
+        if (top() == context::bus && currentKey == "lockFile")
+        {
+            buses.back().policy.lockFile = value;
+            return true;
+        }
+        if (top() == context::backend)
+        {
+            return backend(value);
+        }
+        if (top() == context::aggregate)
+        {
+            return aggregate(aggregates.back(), value);
+        }
+        if (top() == context::trace)
+        {
+            return trace(value);
+        }
+        return scalar();
+    }
+
+    bool binary(Json::binary_t&)
+    {
+        return scalar();
+    }
+
+    bool start_object(std::size_t)
+    {
+        if (skipDepth > 0)
+        {
+            skipDepth++;
+            return true;
+        }
+        if (stack.empty())
+        {
+            stack.push_back(context::root);
+            return true;
+        }
+
+        switch (top())
+        {
+            case context::root:
+                if (currentKey == "threshold")
+                {
+                    thresholdSeen = true;
+                    return push(context::threshold);
+                }
+                if (currentKey == "polling")
+                {
+                    return push(context::polling);
+                }
+                if (currentKey == "telemetry")
+                {
+                    return push(context::telemetry);
+                }
+                if (currentKey == "backend")
+                {
+                    return push(context::backend);
+                }
+                if (currentKey == "i2cTrace")
+                {
+                    return push(context::trace);
+                }
+                if (currentKey == "metrics")
+                {
+                    return push(context::metrics);
+                }
+                if (currentKey == "sampleLog")
+                {
+                    return push(context::sampleLog);
+                }
+                if (currentKey == "burst")
+                {
+                    return push(context::burst);
+                }
+                break;
+            case context::configArray:
+                cards.push_back({defaults, 0, pos.line, pos.column});
+                return push(context::card);
+            case context::busesArray:
+                buses.push_back({busPolicy(), false, pos.line, pos.column});
+                return push(context::bus);
+            case context::aggregatesArray:
+                aggregates.push_back(
+                    {aggregateConfig(), false, pos.line, pos.column});
+                return push(context::aggregate);
+            case context::thresholdArray:
+                return push(context::threshold);
+            case context::card:
+                if (currentKey == "threshold")
+                {
+                    return push(context::cardThreshold);
+                }
+                if (currentKey == "polling")
+                {
+                    return push(context::cardPolling);
+                }
+                break;
+            default:
+                break;
+        }
+
+        return unexpected("an object");
+    }
+
+    bool end_object()
+    {
+        return pop();
+    }
+
+    bool start_array(std::size_t)
+    {
+        if (skipDepth > 0)
+        {
+            skipDepth++;
+            return true;
+        }
+        if (stack.empty())
+        {
+            return error("expected an object");
+        }
+        if (top() == context::root)
+        {
+            if (currentKey == "config")
+            {
+                configSeen = true;
+                return push(context::configArray);
+            }
+            if (currentKey == "threshold")
+            {
+                thresholdSeen = true;
+                return push(context::thresholdArray);
+            }
+            if (currentKey == "buses")
+            {
+                return push(context::busesArray);
+            }
+            if (currentKey == "aggregates")
+            {
+                return push(context::aggregatesArray);
+            }
+        }
+        if (top() == context::aggregate)
+        {
+            if (currentKey == "cards")
+            {
+                return push(context::aggregateCards);
+            }
+            if (currentKey == "weights")
+            {
+                return push(context::aggregateWeights);
+            }
+        }
+
+        return unexpected("an array");
+    }
+
+    bool end_array()
+    {
+        return pop();
+    }
+
+    bool key(Json::string_t& name)
+    {
+        if (skipDepth == 0)
+        {
+            currentKey = name;
+        }
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&,
+                     const nlohmann::detail::exception& e)
+    {
+        return error(e.what());
+    }
+
+    /** @brief Resolve inherited keys once the whole file has been read */
+    daemonConfig finish()
+    {
+        if (!thresholdSeen)
+        {
+            std::cerr << "Invalid config file, thresholds dosen't exist"
+                      << std::endl;
+        }
+        if (!configSeen)
+        {
+            std::cerr << "Invalid Bittware config file, config dosen't exist"
+                      << std::endl;
+        }
+
+        for (const auto& bus : buses)
+        {
+            if (!bus.busIDSet)
+            {
+                return entryError(bus.line, bus.column, "bus without busID");
+            }
+            for (const auto& other : result.buses)
+            {
+                if (other.busID == bus.policy.busID)
+                {
+                    return entryError(bus.line, bus.column,
+                                      "duplicate busID " +
+                                          std::to_string(other.busID));
+                }
+            }
+            result.buses.push_back(bus.policy);
+        }
+
+        for (const auto& entry : aggregates)
+        {
+            const auto& config = entry.config;
+            if (config.name.empty())
+            {
+                return entryError(entry.line, entry.column,
+                                  "aggregate without name");
+            }
+            if (!entry.functionSet)
+            {
+                return entryError(entry.line, entry.column,
+                                  "aggregate without function");
+            }
+            if (config.cards.empty())
+            {
+                return entryError(entry.line, entry.column,
+                                  "aggregate without cards");
+            }
+            if (config.type == aggregateConfig::function::weighted &&
+                config.weights.size() != config.cards.size())
+            {
+                return entryError(entry.line, entry.column,
+                                  "\"weights\" must have one weight per card");
+            }
+            if (config.type == aggregateConfig::function::weighted &&
+                std::accumulate(config.weights.begin(), config.weights.end(),
+                                0.0) <= 0)
+            {
+                return entryError(entry.line, entry.column,
+                                  "\"weights\" must not all be zero");
+            }
+            if (config.type != aggregateConfig::function::weighted &&
+                !config.weights.empty())
+            {
+                return entryError(entry.line, entry.column,
+                                  "\"weights\" is only allowed with the "
+                                  "weighted function");
+            }
+            for (const auto& other : result.aggregates)
+            {
+                if (other.name == config.name)
+                {
+                    return entryError(entry.line, entry.column,
+                                      "duplicate aggregate " + config.name);
+                }
+            }
+            result.aggregates.push_back(config);
+        }
+
+        result.cards.reserve(cards.size());
+        for (auto& card : cards)
+        {
+            for (size_t i = 0; i < thresholdFields.size(); i++)
+            {
+                if (!(card.set & (1 << i)))
+                {
+                    card.config.*thresholdFields[i].second =
+                        defaults.*thresholdFields[i].second;
+                }
+            }
+            if (!(card.set & intervalSet))
+            {
+                card.config.pollInterval = defaults.pollInterval;
+            }
+            if (!(card.set & deadbandSet))
+            {
+                card.config.deadband = defaults.deadband;
+            }
+            if (!(card.set & prioritySet))
+            {
+                card.config.priority = defaults.priority;
+            }
+            if (!(card.set & marginSet))
+            {
+                card.config.margin = defaults.margin;
+            }
+            if (!(card.set & alarmIntervalSet))
+            {
+                card.config.alarmInterval = defaults.alarmInterval;
+            }
+
+            for (const auto& other : result.cards)
+            {
+                if (other.index == card.config.index)
+                {
+                    return entryError(card.line, card.column,
+                                      "duplicate bittwareIndex " +
+                                          std::to_string(other.index));
+                }
+            }
+            result.cards.push_back(card.config);
+        }
+        result.valid = true;
+
+        return std::move(result);
+    }
+
+  private:
+    /** @brief Schema error of a whole array entry, found in finish() */
+    daemonConfig entryError(size_t line, size_t column, const std::string& msg)
+    {
+        std::cerr << "Bittware config " << path << ":" << line << ":"
+                  << column << ": " << msg << std::endl;
+        result.valid = false;
+        return std::move(result);
+    }
+
+    enum class context
+    {
+        root,
+        configArray,
+        card,
+        cardThreshold,
+        cardPolling,
+        thresholdArray,
+        threshold,
+        polling,
+        telemetry,
+        metrics,
+        sampleLog,
+        burst,
+        backend,
+        trace,
+        busesArray,
+        bus,
+        aggregatesArray,
+        aggregate,
+        aggregateCards,
+        aggregateWeights,
+    };
+
+    context top() const
+    {
+        return stack.empty() ? context::root : stack.back();
+    }
+
+    bool push(context ctx)
+    {
+        stack.push_back(ctx);
+        return true;
+    }
+
+    bool pop()
+    {
+        if (skipDepth > 0)
+        {
+            skipDepth--;
+        }
+        else if (!stack.empty())
+        {
+            stack.pop_back();
+        }
+        return true;
+    }
+
+    /** @brief Whether key is part of the schema in the current context */
+    bool knownKey() const
+    {
+        switch (top())
+        {
+            case context::root:
+                return currentKey == "config" || currentKey == "threshold" ||
+                       currentKey == "polling" || currentKey == "telemetry" ||
+                       currentKey == "buses" || currentKey == "backend" ||
+                       currentKey == "i2cTrace" || currentKey == "metrics" ||
+                       currentKey == "sampleLog" ||
+                       currentKey == "aggregates" || currentKey == "burst";
+            case context::card:
+                return currentKey == "bittwareIndex" || currentKey == "bittwareBusID" ||
+                       currentKey == "threshold" || currentKey == "polling";
+            case context::cardThreshold:
+            case context::threshold:
+                for (const auto& field : thresholdFields)
+                {
+                    if (currentKey == field.first)
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            case context::polling:
+                if (currentKey == "budget")
+                {
+                    return true;
+                }
+                [[fallthrough]];
+            case context::cardPolling:
+                return currentKey == "interval" || currentKey == "deadband" ||
+                       currentKey == "priority" || currentKey == "margin" ||
+                       currentKey == "alarmInterval";
+            case context::bus:
+                return currentKey == "busID" || currentKey == "timeout" ||
+                       currentKey == "retries" || currentKey == "lockFile" ||
+                       currentKey == "lockTimeout";
+            case context::telemetry:
+            case context::metrics:
+                return currentKey == "enabled" || currentKey == "path";
+            case context::sampleLog:
+                return currentKey == "enabled" || currentKey == "path" ||
+                       currentKey == "flushInterval" ||
+                       currentKey == "maxSize" || currentKey == "segments";
+            case context::backend:
+                return currentKey == "type" || currentKey == "sysfsRoot" ||
+                       currentKey == "alarmLimits";
+            case context::burst:
+                return currentKey == "enabled" || currentKey == "level" ||
+                       currentKey == "slope" || currentKey == "interval" ||
+                       currentKey == "duration" || currentKey == "preTrigger";
+            case context::aggregate:
+                return currentKey == "name" || currentKey == "function" ||
+                       currentKey == "cards" || currentKey == "weights";
+            case context::trace:
+                return currentKey == "mode" || currentKey == "path" ||
+                       currentKey == "speed";
+            default:
+                return true;
+        }
+    }
+
+    /** @brief Nested value of an unknown key is skipped, of a known one is
+     *         a schema error.
+     */
+    bool unexpected(const std::string& what)
+    {
+        if (inArray() || knownKey())
+        {
+            return error("unexpected " + what +
+                     (currentKey.empty() ? std::string()
+                                         : " for \"" + currentKey + "\""));
+        }
+        skipDepth = 1;
+        return true;
+    }
+
+    /** @brief Whether the current value is an element of a schema array */
+    bool inArray() const
+    {
+        switch (top())
+        {
+            case context::configArray:
+            case context::thresholdArray:
+            case context::busesArray:
+            case context::aggregatesArray:
+            case context::aggregateCards:
+            case context::aggregateWeights:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /** @brief Scalar the schema doesn't expect at this place, values of
+     *         unknown keys are ignored.
+     */
+    bool scalar()
+    {
+        if (skipDepth > 0)
+        {
+            return true;
+        }
+        if (stack.empty() || inArray() || knownKey())
+        {
+            return error("unexpected value" +
+                         (currentKey.empty() ? std::string()
+                                             : " for \"" + currentKey + "\""));
+        }
+        return true;
+    }
+
+    bool integer(int64_t value)
+    {
+        if (skipDepth > 0)
+        {
+            return true;
+        }
+
+        switch (top())
+        {
+            case context::card:
+                if (currentKey == "bittwareIndex" || currentKey == "bittwareBusID")
+                {
+                    if (value < 0 || value > std::numeric_limits<uint8_t>::max())
+                    {
+                        return error("\"" + currentKey + "\" out of range");
+                    }
+                    auto& config = cards.back().config;
+                    (currentKey == "bittwareIndex" ? config.index : config.busID) =
+                        value;
+                    return true;
+                }
+                break;
+            case context::cardThreshold:
+                return threshold(cards.back().config, cards.back().set, value);
+            case context::threshold:
+                return threshold(defaults, defaultsSet, value);
+            case context::cardPolling:
+                if (currentKey == "budget")
+                {
+                    return error("\"budget\" is only allowed in the top "
+                                 "level polling block");
+                }
+                return polling(cards.back().config, cards.back().set, value);
+            case context::polling:
+                if (currentKey == "budget")
+                {
+                    if (value < 0)
+                    {
+                        return error("\"budget\" must not be negative");
+                    }
+                    result.cycleBudget = value;
+                    return true;
+                }
+                return polling(defaults, defaultsSet, value);
+            case context::bus:
+                return bus(buses.back(), value);
+            case context::aggregateCards:
+                if (value < 0 || value > std::numeric_limits<uint8_t>::max())
+                {
+                    return error("card index out of range");
+                }
+                aggregates.back().config.cards.push_back(value);
+                return true;
+            case context::aggregateWeights:
+                return weight(value);
+            case context::burst:
+                if (currentKey == "level" || currentKey == "slope")
+                {
+                    return burstTrigger(value);
+                }
+                if (currentKey == "interval" || currentKey == "duration")
+                {
+                    if (value <= 0)
+                    {
+                        return error("\"" + currentKey + "\" must be positive");
+                    }
+                    (currentKey == "interval" ? result.burst.interval
+                                              : result.burst.duration) = value;
+                    return true;
+                }
+                if (currentKey == "preTrigger")
+                {
+                    if (value < 0 || value > BURST_MAX_PRETRIGGER)
+                    {
+                        return error("\"preTrigger\" out of range");
+                    }
+                    result.burst.preTrigger = value;
+                    return true;
+                }
+                break;
+            case context::sampleLog:
+                if ((currentKey == "flushInterval" || currentKey == "maxSize" ||
+                     currentKey == "segments") &&
+                    value <= 0)
+                {
+                    return error("\"" + currentKey + "\" must be positive");
+                }
+                if (currentKey == "flushInterval")
+                {
+                    result.sampleLogFlushInterval = value;
+                    return true;
+                }
+                if (currentKey == "maxSize")
+                {
+                    result.sampleLogMaxSize = value;
+                    return true;
+                }
+                if (currentKey == "segments")
+                {
+                    if (value > std::numeric_limits<uint32_t>::max())
+                    {
+                        return error("\"segments\" out of range");
+                    }
+                    result.sampleLogSegments = value;
+                    return true;
+                }
+                break;
+            case context::trace:
+                if (currentKey == "speed")
+                {
+                    if (value < 0 || value > std::numeric_limits<int>::max())
+                    {
+                        return error("\"speed\" out of range");
+                    }
+                    result.trace.speed = value;
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+
+        return scalar();
+    }
+
+    bool threshold(bittwareConfig& config, uint32_t& set, int64_t value)
+    {
+        for (size_t i = 0; i < thresholdFields.size(); i++)
+        {
+            if (currentKey == thresholdFields[i].first)
+            {
+                config.*thresholdFields[i].second = value;
+                set |= (1 << i);
+                return true;
+            }
+        }
+        return scalar();
+    }
+
+    bool polling(bittwareConfig& config, uint32_t& set, int64_t value)
+    {
+        if (currentKey == "interval")
+        {
+            if (value <= 0)
+            {
+                return error("\"interval\" must be positive");
+            }
+            config.pollInterval = value;
+            set |= intervalSet;
+            return true;
+        }
+        if (currentKey == "alarmInterval")
+        {
+            if (value < 0)
+            {
+                return error("\"alarmInterval\" must not be negative");
+            }
+            config.alarmInterval = value;
+            set |= alarmIntervalSet;
+            return true;
+        }
+        if (currentKey == "deadband" || currentKey == "margin")
+        {
+            return degrees(value);
+        }
+        if (currentKey == "priority")
+        {
+            if (value < 0 || value > std::numeric_limits<uint8_t>::max())
+            {
+                return error("\"priority\" out of range");
+            }
+            config.priority = value;
+            set |= prioritySet;
+            return true;
+        }
+        return scalar();
+    }
+
+    bool backend(const std::string& value)
+    {
+        if (currentKey == "sysfsRoot")
+        {
+            result.backend.sysfsRoot = value;
+            return true;
+        }
+        if (currentKey == "type")
+        {
+            if (value == "i2c-dev")
+            {
+                result.backend.mode = backendConfig::type::i2cdev;
+            }
+            else if (value == "hwmon")
+            {
+                result.backend.mode = backendConfig::type::hwmon;
+            }
+            else if (value == "auto")
+            {
+                result.backend.mode = backendConfig::type::automatic;
+            }
+            else
+            {
+                return error("\"type\" must be \"i2c-dev\", \"hwmon\" or "
+                             "\"auto\"");
+            }
+            return true;
+        }
+        return scalar();
+    }
+
+    bool trace(const std::string& value)
+    {
+        if (currentKey == "path")
+        {
+            result.trace.path = value;
+            return true;
+        }
+        if (currentKey == "mode")
+        {
+            if (value == "off")
+            {
+                result.trace.mode = traceConfig::type::off;
+            }
+            else if (value == "record")
+            {
+                result.trace.mode = traceConfig::type::record;
+            }
+            else if (value == "replay")
+            {
+                result.trace.mode = traceConfig::type::replay;
+            }
+            else
+            {
+                return error("\"mode\" must be \"off\", \"record\" or "
+                             "\"replay\"");
+            }
+            return true;
+        }
+        return scalar();
+    }
+
+    bool aggregate(aggregateEntry& entry, const std::string& value)
+    {
+        if (currentKey == "name")
+        {
+            /* Becomes the last element of an object path */
+            if (value.empty() ||
+                value.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                        "abcdefghijklmnopqrstuvwxyz"
+                                        "0123456789_") != std::string::npos)
+            {
+                return error("\"name\" must be letters, digits and "
+                             "underscores");
+            }
+            /* Shares the directory of the card sensors, Bittware<index> */
+            std::string card(BITTWARE_SOC_OBJ_PATH);
+            card = card.substr(card.find_last_of('/') + 1);
+            if (value.size() > card.size() &&
+                value.compare(0, card.size(), card) == 0 &&
+                value.find_first_not_of("0123456789", card.size()) ==
+                    std::string::npos)
+            {
+                return error("\"name\" " + value +
+                             " is the name of a card sensor");
+            }
+            entry.config.name = value;
+            return true;
+        }
+        if (currentKey == "function")
+        {
+            if (value == "max")
+            {
+                entry.config.type = aggregateConfig::function::max;
+            }
+            else if (value == "mean")
+            {
+                entry.config.type = aggregateConfig::function::mean;
+            }
+            else if (value == "weighted")
+            {
+                entry.config.type = aggregateConfig::function::weighted;
+            }
+            else
+            {
+                return error("\"function\" must be \"max\", \"mean\" or "
+                             "\"weighted\"");
+            }
+            entry.functionSet = true;
+            return true;
+        }
+        return scalar();
+    }
+
+    /** @brief Burst trigger keys given in degrees C: level and slope */
+    bool burstTrigger(double value)
+    {
+        if (currentKey == "level")
+        {
+            result.burst.level = value;
+            result.burst.levelSet = true;
+            return true;
+        }
+        if (value < 0)
+        {
+            return error("\"slope\" must not be negative");
+        }
+        result.burst.slope = value;
+        return true;
+    }
+
+    bool weight(double value)
+    {
+        if (value < 0)
+        {
+            return error("weights must not be negative");
+        }
+        aggregates.back().config.weights.push_back(value);
+        return true;
+    }
+
+    bool bus(busEntry& entry, int64_t value)
+    {
+        if (currentKey == "busID")
+        {
+            if (value < 0 || value > std::numeric_limits<uint8_t>::max())
+            {
+                return error("\"busID\" out of range");
+            }
+            entry.policy.busID = value;
+            entry.busIDSet = true;
+            return true;
+        }
+        if (currentKey == "timeout")
+        {
+            if (value < BUS_TIMEOUT_MIN || value > BUS_TIMEOUT_MAX)
+            {
+                return error("\"timeout\" must be between " +
+                             std::to_string(BUS_TIMEOUT_MIN) + " and " +
+                             std::to_string(BUS_TIMEOUT_MAX) + " ms");
+            }
+            entry.policy.timeout = value;
+            return true;
+        }
+        if (currentKey == "retries")
+        {
+            if (value < 0 || value > BUS_RETRIES_MAX)
+            {
+                return error("\"retries\" out of range");
+            }
+            entry.policy.retries = value;
+            return true;
+        }
+        if (currentKey == "lockTimeout")
+        {
+            if (value < 0 || value > BUS_LOCK_TIMEOUT_MAX)
+            {
+                return error("\"lockTimeout\" out of range");
+            }
+            entry.policy.lockTimeout = value;
+            return true;
+        }
+        return scalar();
+    }
+
+    /** @brief Polling keys given in degrees C: deadband and margin */
+    bool degrees(double value)
+    {
+        if (value < 0)
+        {
+            return error("\"" + currentKey + "\" must not be negative");
+        }
+        auto field = (currentKey == "deadband") ? &bittwareConfig::deadband
+                                                : &bittwareConfig::margin;
+        auto bit = (currentKey == "deadband") ? deadbandSet : marginSet;
+        if (top() == context::cardPolling)
+        {
+            cards.back().config.*field = value;
+            cards.back().set |= bit;
+        }
+        else
+        {
+            defaults.*field = value;
+            defaultsSet |= bit;
+        }
+        return true;
+    }
+
+    bool error(const std::string& msg)
+    {
+        std::cerr << "Bittware config " << path << ":" << pos.line << ":"
+                  << pos.column << ": " << msg << std::endl;
+        return false;
+    }
+
+    const std::string& path;
+    const positionBuf& pos;
+    daemonConfig result;
+    bittwareConfig defaults;
+    uint32_t defaultsSet = 0;
+    std::vector<cardEntry> cards;
+    std::vector<busEntry> buses;
+    std::vector<aggregateEntry> aggregates;
+    std::vector<context> stack;
+    std::string currentKey;
+    /** @brief Depth inside a value of an unknown key */
+    size_t skipDepth = 0;
+    bool thresholdSeen = false;
+    bool configSeen = false;
+};
+}
+
+daemonConfig parseConfig(const std::string& path)
+{
+    std::ifstream jsonFile(path);
+    if (!jsonFile.is_open())
+    {
+        std::cerr << "Bittware config JSON file not found" << std::endl;
+        return daemonConfig();
+    }
+
+    positionBuf pos(jsonFile.rdbuf());
+    std::istream input(&pos);
+    configHandler handler(path, pos);
+
+    bool parsed = false;
+    try
+    {
+        parsed = Json::sax_parse(input, &handler);
+    }
+    catch (const Json::exception& e)
+    {
+        std::cerr << "Json Exception caught. MSG: " << e.what() << std::endl;
+    }
+    if (!parsed)
+    {
+        std::cerr << "Bittware config readings JSON parser failure"
+                  << std::endl;
+        return daemonConfig();
+    }
+
+    return handler.finish();
+}
+}
+}
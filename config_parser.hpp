@@ -0,0 +1,109 @@
+#pragma once
+
+#include "bittware_soc.hpp"
+
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+/** @brief I2C adapter settings of one bus, -1 keeps the kernel default */
+struct busPolicy
+{
+    uint8_t busID;
+    /** @brief Transaction timeout in milliseconds. Timeout and retries of
+     *         a mux channel are set on its parent adapter.
+     */
+    int timeout = -1;
+    /** @brief Retries on arbitration loss */
+    int retries = -1;
+    /** @brief File flock()ed around transaction sequences, shared with
+     *         the other services using the bus. Empty for no locking.
+     */
+    std::string lockFile;
+    /** @brief Longest wait for the lock file in milliseconds, the
+     *         transactions fail after it. -1 for BUS_LOCK_TIMEOUT_MS.
+     */
+    int lockTimeout = -1;
+};
+
+/** @brief Recording or replay of the I2C transactions, startup only */
+struct traceConfig
+{
+    enum class type
+    {
+        off,
+        record,
+        replay,
+    };
+    type mode = type::off;
+    std::string path;
+    /** @brief Replay latencies are divided by speed, 0 replays at once */
+    int speed = 1;
+};
+
+/** @brief Sensor derived from the readings of a group of cards */
+struct aggregateConfig
+{
+    enum class function
+    {
+        max,
+        mean,
+        /** @brief Mean weighted by weights, renormalized over the cards
+         *         that have a reading
+         */
+        weighted,
+    };
+    /** @brief Object name under the temperature sensors */
+    std::string name;
+    function type = function::max;
+    /** @brief Indexes of the cards the sensor is derived from */
+    std::vector<uint8_t> cards;
+    /** @brief Weight of each card, weighted only */
+    std::vector<double> weights;
+};
+
+/** @brief Settings of the daemon read from bittware_config.json */
+struct daemonConfig
+{
+    /** @brief False if the file is missing, malformed or breaks the schema */
+    bool valid = false;
+    std::vector<bittwareSOC::bittwareConfig> cards;
+    std::vector<busPolicy> buses;
+    std::vector<aggregateConfig> aggregates;
+    /** @brief Time in milliseconds a poll cycle may spend reading cards that
+     *         aren't near their limits, 0 for no limit.
+     */
+    uint64_t cycleBudget = 0;
+    bool telemetryEnabled = false;
+    std::string telemetryPath;
+    /** @brief Persistent log of the samples */
+    bool sampleLogEnabled = false;
+    std::string sampleLogPath;
+    /** @brief Seconds between appends to the log */
+    uint64_t sampleLogFlushInterval = 300;
+    /** @brief Size budget of the log in bytes */
+    uint64_t sampleLogMaxSize = 1048576;
+    uint32_t sampleLogSegments = 4;
+    /** @brief Prometheus metrics on a Unix socket */
+    bool metricsEnabled = false;
+    std::string metricsPath;
+    /** @brief Access path of the card sensors and EEPROMs */
+    backendConfig backend;
+    /** @brief High rate sampling around thermal transients */
+    burstConfig burst;
+    traceConfig trace;
+};
+
+/** @brief Parse the config file straight into daemonConfig.
+ *
+ *  The file is streamed through a SAX handler, no JSON DOM is built.
+ *  Syntax and schema errors are reported with their line and column.
+ *
+ * @param[in] path - Config file to parse
+ */
+daemonConfig parseConfig(const std::string& path);
+}
+}
@@ -0,0 +1,222 @@
+#include "config.h"
+#include "expander_control.hpp"
+
+#include <sdbusplus/message.hpp>
+
+#include <iostream>
+
+/* Lines of the expander */
+#define IO_EXPANDER_LINES 8
+
+namespace phosphor
+{
+namespace mpSOC
+{
+const sdbusplus::vtable::vtable_t expanderControl::vtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("SMBusEnabled", "b",
+                                expanderControl::getSMBusEnabled,
+                                expanderControl::setSMBusEnabled,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::property("Direction", "y",
+                                expanderControl::getDirection,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::property("Output", "y", expanderControl::getOutput,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::method("SetLine", "yb", "", expanderControl::setLine),
+    sdbusplus::vtable::method("ReleaseLine", "y", "",
+                              expanderControl::releaseLine),
+    sdbusplus::vtable::end()};
+
+expanderControl::expanderControl(sdbusplus::bus::bus& bus,
+                                 const char* objPath, ioExpander& expander,
+                                 uint8_t enableMask) :
+    expander(expander),
+    enableMask(enableMask),
+    iface(bus, objPath, BITTWARE_SOC_EXPANDER_IFACE, vtable, this)
+{
+}
+
+bool expanderControl::smbusEnabled() const
+{
+    return !(expander.direction() & enableMask) &&
+           (expander.output() & enableMask);
+}
+
+bool expanderControl::drive(uint8_t mask, bool high)
+{
+    return expander.setOutput(mask, high) &&
+           expander.setDirection(mask, false);
+}
+
+void expanderControl::changed(uint8_t direction, uint8_t output, bool enabled)
+{
+    if (direction != expander.direction())
+    {
+        iface.property_changed("Direction");
+    }
+    if (output != expander.output())
+    {
+        iface.property_changed("Output");
+    }
+    if (enabled != smbusEnabled())
+    {
+        iface.property_changed("SMBusEnabled");
+    }
+}
+
+int expanderControl::getSMBusEnabled(sd_bus*, const char*, const char*,
+                                     const char*, sd_bus_message* reply,
+                                     void* context, sd_bus_error*)
+{
+    auto self = static_cast<expanderControl*>(context);
+    try
+    {
+        sdbusplus::message::message(reply).append(self->smbusEnabled());
+    }
+    catch (const std::exception&)
+    {
+        return -EIO;
+    }
+    return 1;
+}
+
+int expanderControl::setSMBusEnabled(sd_bus*, const char*, const char*,
+                                     const char*, sd_bus_message* value,
+                                     void* context, sd_bus_error*)
+{
+    auto self = static_cast<expanderControl*>(context);
+    bool enable;
+    try
+    {
+        sdbusplus::message::message(value).read(enable);
+    }
+    catch (const std::exception&)
+    {
+        return -EINVAL;
+    }
+
+    auto direction = self->expander.direction();
+    auto output = self->expander.output();
+    auto enabled = self->smbusEnabled();
+    /* Disabling drives the line low, it stays an output */
+    auto res = self->drive(self->enableMask, enable);
+    self->changed(direction, output, enabled);
+    if (!res)
+    {
+        std::cerr << "Failed to set SMBus enable line" << std::endl;
+        return -EIO;
+    }
+    return 1;
+}
+
+int expanderControl::getDirection(sd_bus*, const char*, const char*,
+                                  const char*, sd_bus_message* reply,
+                                  void* context, sd_bus_error*)
+{
+    auto self = static_cast<expanderControl*>(context);
+    try
+    {
+        sdbusplus::message::message(reply).append(self->expander.direction());
+    }
+    catch (const std::exception&)
+    {
+        return -EIO;
+    }
+    return 1;
+}
+
+int expanderControl::getOutput(sd_bus*, const char*, const char*, const char*,
+                               sd_bus_message* reply, void* context,
+                               sd_bus_error*)
+{
+    auto self = static_cast<expanderControl*>(context);
+    try
+    {
+        sdbusplus::message::message(reply).append(self->expander.output());
+    }
+    catch (const std::exception&)
+    {
+        return -EIO;
+    }
+    return 1;
+}
+
+int expanderControl::setLine(sd_bus_message* msg, void* context,
+                             sd_bus_error*)
+{
+    auto self = static_cast<expanderControl*>(context);
+    try
+    {
+        auto m = sdbusplus::message::message(msg);
+        uint8_t line;
+        bool high;
+        m.read(line, high);
+        if (line >= IO_EXPANDER_LINES)
+        {
+            return -EINVAL;
+        }
+
+        auto direction = self->expander.direction();
+        auto output = self->expander.output();
+        auto enabled = self->smbusEnabled();
+        auto res = self->drive(1 << line, high);
+        self->changed(direction, output, enabled);
+        if (!res)
+        {
+            std::cerr << "Failed to drive IO expander line " << (int)line
+                      << std::endl;
+            return -EIO;
+        }
+
+        auto reply = m.new_method_return();
+        reply.method_return();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "SetLine fail. ERROR = " << e.what() << std::endl;
+        return -EIO;
+    }
+
+    return 1;
+}
+
+int expanderControl::releaseLine(sd_bus_message* msg, void* context,
+                                 sd_bus_error*)
+{
+    auto self = static_cast<expanderControl*>(context);
+    try
+    {
+        auto m = sdbusplus::message::message(msg);
+        uint8_t line;
+        m.read(line);
+        if (line >= IO_EXPANDER_LINES)
+        {
+            return -EINVAL;
+        }
+
+        auto direction = self->expander.direction();
+        auto output = self->expander.output();
+        auto enabled = self->smbusEnabled();
+        auto res = self->expander.setDirection(1 << line, true);
+        self->changed(direction, output, enabled);
+        if (!res)
+        {
+            std::cerr << "Failed to release IO expander line " << (int)line
+                      << std::endl;
+            return -EIO;
+        }
+
+        auto reply = m.new_method_return();
+        reply.method_return();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "ReleaseLine fail. ERROR = " << e.what() << std::endl;
+        return -EIO;
+    }
+
+    return 1;
+}
+}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "io_expander.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/interface.hpp>
+#include <sdbusplus/vtable.hpp>
+
+#include <cstdint>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+/** @class expanderControl
+ *  @brief Lets operators drive the IO expander lines of a card.
+ *
+ *  Properties are served from the expander shadows, reading them doesn't
+ *  touch the bus, and each change is a single register write.
+ *
+ *  SMBusEnabled (b, read-write) gates the SMBus of the card. Direction (y)
+ *  and Output (y) are the expander registers, a set Direction bit is an
+ *  input. SetLine(y line, b high) drives a line, turning it into an
+ *  output, ReleaseLine(y line) turns it back into an input.
+ */
+class expanderControl
+{
+  public:
+    expanderControl() = delete;
+    expanderControl(const expanderControl&) = delete;
+    expanderControl& operator=(const expanderControl&) = delete;
+    expanderControl(expanderControl&&) = delete;
+    expanderControl& operator=(expanderControl&&) = delete;
+    virtual ~expanderControl() = default;
+
+    /** @brief Constructs expanderControl
+     *
+     * @param[in] bus        - Handle to system dbus
+     * @param[in] objPath    - The dbus path the interface is served on
+     * @param[in] expander   - Expander of the card, must outlive this
+     * @param[in] enableMask - Line gating the card SMBus
+     */
+    expanderControl(sdbusplus::bus::bus& bus, const char* objPath,
+                    ioExpander& expander, uint8_t enableMask);
+
+  private:
+    static int getSMBusEnabled(sd_bus* bus, const char* path,
+                               const char* interface, const char* property,
+                               sd_bus_message* reply, void* context,
+                               sd_bus_error* error);
+    static int setSMBusEnabled(sd_bus* bus, const char* path,
+                               const char* interface, const char* property,
+                               sd_bus_message* value, void* context,
+                               sd_bus_error* error);
+    static int getDirection(sd_bus* bus, const char* path,
+                            const char* interface, const char* property,
+                            sd_bus_message* reply, void* context,
+                            sd_bus_error* error);
+    static int getOutput(sd_bus* bus, const char* path, const char* interface,
+                         const char* property, sd_bus_message* reply,
+                         void* context, sd_bus_error* error);
+    static int setLine(sd_bus_message* msg, void* context,
+                       sd_bus_error* error);
+    static int releaseLine(sd_bus_message* msg, void* context,
+                           sd_bus_error* error);
+
+    static const sdbusplus::vtable::vtable_t vtable[];
+
+    bool smbusEnabled() const;
+    /** @brief Drive the masked lines, outputs are set before the lines
+     *         turn into outputs so they don't glitch.
+     */
+    bool drive(uint8_t mask, bool high);
+    /** @brief Signal the properties that changed since the given state */
+    void changed(uint8_t direction, uint8_t output, bool enabled);
+
+    ioExpander& expander;
+    uint8_t enableMask;
+    sdbusplus::server::interface::interface iface;
+};
+}
+}
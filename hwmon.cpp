@@ -0,0 +1,131 @@
+#include "hwmon.hpp"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+namespace hwmon
+{
+std::string deviceDir(const std::string& sysfsRoot, int bus, uint8_t addr)
+{
+    char name[16];
+    snprintf(name, sizeof(name), "%d-%04x", bus, addr);
+    return sysfsRoot + "/bus/i2c/devices/" + name;
+}
+
+int openAttribute(const std::string& sysfsRoot, int bus, uint8_t addr,
+                  const std::string& attr, bool writable)
+{
+    auto dir = deviceDir(sysfsRoot, bus, addr) + "/hwmon";
+    auto d = opendir(dir.c_str());
+    if (!d)
+    {
+        return -1;
+    }
+
+    int fd = -1;
+    struct dirent* entry;
+    while (fd < 0 && (entry = readdir(d)) != nullptr)
+    {
+        if (strncmp(entry->d_name, "hwmon", 5) != 0)
+        {
+            continue;
+        }
+        auto path = dir + "/" + entry->d_name + "/" + attr;
+        fd = open(path.c_str(), (writable ? O_WRONLY : O_RDONLY) | O_CLOEXEC);
+    }
+    closedir(d);
+
+    return fd;
+}
+
+int readAttribute(int fd, int64_t& value)
+{
+    char buf[32];
+    auto len = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (len < 0)
+    {
+        return -errno;
+    }
+    if (len == 0)
+    {
+        return -ENODATA;
+    }
+    buf[len] = '\0';
+
+    char* end;
+    errno = 0;
+    value = strtoll(buf, &end, 10);
+    if (errno != 0 || end == buf)
+    {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+int writeAttribute(int fd, int64_t value)
+{
+    char buf[32];
+    auto len = snprintf(buf, sizeof(buf), "%lld\n", (long long)value);
+    auto res = pwrite(fd, buf, len, 0);
+    if (res < 0)
+    {
+        return -errno;
+    }
+    return (res == len) ? 0 : -EIO;
+}
+
+int readNvmem(const std::string& sysfsRoot, int bus, uint8_t addr,
+              unsigned char* buf, size_t len)
+{
+    auto dir = deviceDir(sysfsRoot, bus, addr);
+    char name[16];
+    snprintf(name, sizeof(name), "%d-%04x0", bus, addr);
+
+    /* at24 keeps the legacy eeprom attribute next to the nvmem device */
+    int fd = open((dir + "/eeprom").c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        fd = open((dir + "/" + name + "/nvmem").c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0)
+    {
+        return -errno;
+    }
+
+    size_t done = 0;
+    while (done < len)
+    {
+        auto res = pread(fd, buf + done, len - done, done);
+        if (res < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (res < 0)
+        {
+            auto err = -errno;
+            close(fd);
+            return err;
+        }
+        /* EEPROM smaller than requested */
+        if (res == 0)
+        {
+            break;
+        }
+        done += res;
+    }
+    close(fd);
+
+    return done;
+}
+} // namespace hwmon
+}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+/** @brief How the TMP431 and the VPD EEPROM of the cards are accessed */
+struct backendConfig
+{
+    enum class type
+    {
+        /** @brief Raw transactions through /dev/i2c-N */
+        i2cdev,
+        /** @brief tmp401 hwmon and at24 nvmem of the kernel drivers only */
+        hwmon,
+        /** @brief hwmon/nvmem where the drivers are bound, i2c-dev else */
+        automatic,
+    };
+    type mode = type::automatic;
+    /** @brief sysfs mount point, a fake tree for tests */
+    std::string sysfsRoot = "/sys";
+    /** @brief Set the tmp401 max limit to warningHigh so its alarm fires
+     *         at the D-Bus warning level. The crit limit drives the THERM
+     *         output and is always left to the hardware default.
+     */
+    bool alarmLimits = false;
+};
+
+namespace hwmon
+{
+/** @brief sysfs directory of the I2C client at addr on bus */
+std::string deviceDir(const std::string& sysfsRoot, int bus, uint8_t addr);
+
+/** @brief Open an attribute of the hwmon device bound to the I2C client,
+ *         e.g. temp1_input.
+ *
+ * @param[in] writable - Open for writeAttribute() instead of reading
+ *
+ * @return fd to be read with readAttribute(), -1 if there's no such
+ *         attribute, the driver isn't bound.
+ */
+int openAttribute(const std::string& sysfsRoot, int bus, uint8_t addr,
+                  const std::string& attr, bool writable = false);
+
+/** @brief Read an integer attribute through a kept open fd, sysfs
+ *         regenerates the value on each read at offset 0.
+ *
+ * @return 0 or -errno
+ */
+int readAttribute(int fd, int64_t& value);
+
+/** @brief Write an integer attribute, e.g. a temp1_max limit
+ *
+ * @return 0 or -errno
+ */
+int writeAttribute(int fd, int64_t value);
+
+/** @brief Read the EEPROM of an at24 bound I2C client through nvmem
+ *
+ * @return Number of bytes read, less than len if the EEPROM is smaller,
+ *         -errno if the driver isn't bound or the read failed.
+ */
+int readNvmem(const std::string& sysfsRoot, int bus, uint8_t addr,
+              unsigned char* buf, size_t len);
+} // namespace hwmon
+}
+}
@@ -0,0 +1,50 @@
+#include "i2c_topology.hpp"
+
+#include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+const i2cTopology::location& i2cTopology::locate(int bus)
+{
+    auto found = cache.find(bus);
+    if (found != cache.end())
+    {
+        return found->second;
+    }
+
+    location loc{bus, 0};
+    auto link = sysfsRoot + "/bus/i2c/devices/i2c-" + std::to_string(bus) +
+                "/mux_device";
+    char target[PATH_MAX];
+    auto len = readlink(link.c_str(), target, sizeof(target) - 1);
+    if (len > 0)
+    {
+        target[len] = '\0';
+        std::string name(target);
+        name = name.substr(name.find_last_of('/') + 1);
+
+        int parent;
+        unsigned int addr;
+        if (sscanf(name.c_str(), "%d-%x", &parent, &addr) == 2)
+        {
+            loc.parentBus = parent;
+            loc.muxAddr = addr;
+        }
+    }
+
+    return cache.emplace(bus, loc).first->second;
+}
+
+uint32_t i2cTopology::orderKey(int bus)
+{
+    const auto& loc = locate(bus);
+    return (static_cast<uint32_t>(loc.parentBus & 0xffff) << 16) |
+           (static_cast<uint32_t>(loc.muxAddr) << 8) |
+           static_cast<uint32_t>(bus & 0xff);
+}
+}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+/** @class i2cTopology
+ *  @brief Where each I2C bus sits behind muxes, discovered from sysfs.
+ *
+ *  A mux channel adapter i2c-N has a mux_device link to the mux client,
+ *  named <parent bus>-<address>, e.g. 5-0070.
+ */
+class i2cTopology
+{
+  public:
+    struct location
+    {
+        /** @brief Bus the mux sits on, the bus itself if it isn't a channel */
+        int parentBus;
+        /** @brief Address of the mux on its parent bus, 0 if not a channel */
+        uint8_t muxAddr;
+    };
+
+    /** @brief Constructs i2cTopology
+     *
+     * @param[in] sysfsRoot - sysfs mount point, a fake tree for tests
+     */
+    explicit i2cTopology(const std::string& sysfsRoot = "/sys") :
+        sysfsRoot(sysfsRoot)
+    {
+    }
+
+    /** @brief Mux location of a bus, looked up once and cached */
+    const location& locate(int bus);
+
+    /** @brief Key ordering buses so that channels of one mux are adjacent,
+     *         reading in key order minimises mux channel switches.
+     */
+    uint32_t orderKey(int bus);
+
+  private:
+    std::string sysfsRoot;
+    std::map<int, location> cache;
+};
+}
+}
@@ -0,0 +1,149 @@
+#include "i2c_trace.hpp"
+
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+/* Records are written in batches of this size */
+#define TRACE_BUFFER_SIZE (64 * 1024)
+
+namespace phosphor
+{
+namespace smbus
+{
+namespace trace
+{
+recorder::recorder(const std::string& path) :
+    begin(std::chrono::steady_clock::now())
+{
+    file = fopen(path.c_str(), "we");
+    if (!file)
+    {
+        std::cerr << "Failed to create I2C trace " << path << ": "
+                  << strerror(errno) << std::endl;
+        return;
+    }
+    setvbuf(file, nullptr, _IOFBF, TRACE_BUFFER_SIZE);
+
+    fileHeader hdr{magic, version, sizeof(record)};
+    fwrite(&hdr, sizeof(hdr), 1, file);
+}
+
+recorder::~recorder()
+{
+    if (file)
+    {
+        fclose(file);
+    }
+}
+
+void recorder::add(uint8_t bus, uint8_t addr, op type, uint8_t cmd,
+                   int32_t result, int error,
+                   std::chrono::steady_clock::time_point start,
+                   const unsigned char* data, uint16_t length)
+{
+    using namespace std::chrono;
+    auto now = steady_clock::now();
+
+    record rec{};
+    rec.timestamp = duration_cast<nanoseconds>(start - begin).count();
+    rec.latency = std::min<uint64_t>(
+        duration_cast<microseconds>(now - start).count(),
+        std::numeric_limits<uint32_t>::max());
+    rec.result = result;
+    rec.error = (result < 0) ? error : 0;
+    rec.length = data ? length : 0;
+    rec.bus = bus;
+    rec.addr = addr;
+    rec.type = type;
+    rec.cmd = cmd;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file)
+    {
+        return;
+    }
+    fwrite(&rec, sizeof(rec), 1, file);
+    if (rec.length)
+    {
+        fwrite(data, 1, rec.length, file);
+    }
+}
+
+player::player(const std::string& path, int speed) : speed(speed)
+{
+    auto file = fopen(path.c_str(), "re");
+    if (!file)
+    {
+        std::cerr << "Failed to open I2C trace " << path << ": "
+                  << strerror(errno) << std::endl;
+        return;
+    }
+
+    fileHeader hdr;
+    if (fread(&hdr, sizeof(hdr), 1, file) != 1 || hdr.magic != magic ||
+        hdr.version != version || hdr.recordSize != sizeof(record))
+    {
+        std::cerr << "Not an I2C trace: " << path << std::endl;
+        fclose(file);
+        return;
+    }
+
+    entry e;
+    while (fread(&e.rec, sizeof(e.rec), 1, file) == 1)
+    {
+        e.data.resize(e.rec.length);
+        if (e.rec.length && fread(e.data.data(), 1, e.rec.length, file) !=
+                                e.rec.length)
+        {
+            std::cerr << "Truncated I2C trace: " << path << std::endl;
+            break;
+        }
+        buses[e.rec.bus].push_back(e);
+    }
+    fclose(file);
+    loaded = true;
+}
+
+int player::transfer(uint8_t bus, uint8_t addr, op type, uint8_t cmd,
+                     unsigned char* data, uint16_t length)
+{
+    entry e;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& records = buses[bus];
+        auto found = std::find_if(records.begin(), records.end(),
+                                  [&](const entry& r) {
+                                      return r.rec.addr == addr &&
+                                             r.rec.type == type &&
+                                             r.rec.cmd == cmd;
+                                  });
+        if (found == records.end())
+        {
+            errno = ENXIO;
+            return -1;
+        }
+        e = std::move(*found);
+        records.erase(found);
+    }
+
+    if (speed > 0)
+    {
+        std::this_thread::sleep_for(
+            std::chrono::microseconds(e.rec.latency) / speed);
+    }
+    if (data)
+    {
+        std::copy_n(e.data.begin(), std::min<size_t>(length, e.data.size()),
+                    data);
+    }
+    errno = e.rec.error;
+    return e.rec.result;
+}
+} // namespace trace
+} // namespace smbus
+} // namespace phosphor
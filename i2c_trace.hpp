@@ -0,0 +1,141 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace smbus
+{
+namespace trace
+{
+constexpr uint32_t magic = 0x43325742; /* "BW2C" */
+/* 2: latency in microseconds */
+constexpr uint16_t version = 2;
+
+/** @brief Smbus primitive a record was taken from */
+enum class op : uint8_t
+{
+    /** @brief smbusCheckSlave, quick write */
+    quick = 0,
+    /** @brief GetSmbusCmdByte, the byte read is the result */
+    readByte = 1,
+    /** @brief SetSmbusCmdByte, data holds the byte written */
+    writeByte = 2,
+    /** @brief smbusSequentialRead from offset cmd, data holds the bytes */
+    sequentialRead = 3,
+};
+
+/** @brief Fixed binary layout of the file header, little endian */
+struct fileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+};
+static_assert(sizeof(fileHeader) == 8, "trace header layout changed");
+
+/** @brief Fixed binary layout of a record, length bytes of data follow */
+struct record
+{
+    /** @brief Nanoseconds since the trace started */
+    uint64_t timestamp;
+    /** @brief Microseconds the transaction took, saturates */
+    uint32_t latency;
+    /** @brief Return value of the primitive */
+    int32_t result;
+    /** @brief errno after a failed transaction, 0 otherwise */
+    uint16_t error;
+    uint16_t length;
+    uint8_t bus;
+    uint8_t addr;
+    op type;
+    uint8_t cmd;
+};
+static_assert(sizeof(record) == 24, "trace record layout changed");
+
+/** @class recorder
+ *  @brief Appends every transaction to a trace file, buffered so the bus
+ *         isn't held for the file write.
+ */
+class recorder
+{
+  public:
+    recorder(const recorder&) = delete;
+    recorder& operator=(const recorder&) = delete;
+    ~recorder();
+
+    /** @brief Create the trace file, ready() tells if that failed */
+    explicit recorder(const std::string& path);
+
+    bool ready() const
+    {
+        return file != nullptr;
+    }
+
+    void add(uint8_t bus, uint8_t addr, op type, uint8_t cmd, int32_t result,
+             int error, std::chrono::steady_clock::time_point start,
+             const unsigned char* data, uint16_t length);
+
+  private:
+    std::mutex mutex;
+    FILE* file = nullptr;
+    std::chrono::steady_clock::time_point begin;
+};
+
+/** @class player
+ *  @brief Answers transactions from a trace instead of the hardware.
+ *
+ *  Each bus replays its records in order. A transaction takes the first
+ *  unused record of its bus with the same address, primitive and command,
+ *  so a run that skips a transaction of the recording stays in step.
+ */
+class player
+{
+  public:
+    player(const player&) = delete;
+    player& operator=(const player&) = delete;
+
+    /** @brief Load a trace, ready() tells if that failed
+     *
+     * @param[in] speed - Recorded latencies are divided by speed, 0 answers
+     *                    right away
+     */
+    player(const std::string& path, int speed);
+
+    bool ready() const
+    {
+        return loaded;
+    }
+
+    /** @brief Replay a transaction
+     *
+     * @param[out] data - Filled with the recorded data, up to length bytes
+     *
+     * @return Recorded result, -1 with errno ENXIO once the trace ran out
+     */
+    int transfer(uint8_t bus, uint8_t addr, op type, uint8_t cmd,
+                 unsigned char* data, uint16_t length);
+
+  private:
+    struct entry
+    {
+        record rec;
+        std::vector<unsigned char> data;
+    };
+
+    std::mutex mutex;
+    bool loaded = false;
+    int speed;
+    std::map<uint8_t, std::deque<entry>> buses;
+};
+} // namespace trace
+} // namespace smbus
+} // namespace phosphor
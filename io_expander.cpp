@@ -0,0 +1,163 @@
+#include "io_expander.hpp"
+#include "ratelimit.hpp"
+#include "smbus.hpp"
+
+#include <cerrno>
+
+#define IO_EXPANDER_COMMAND_1 0x01
+#define IO_EXPANDER_COMMAND_3 0x03
+
+namespace phosphor
+{
+namespace mpSOC
+{
+bool ioExpander::present()
+{
+    auto bus = phosphor::smbus::Smbus();
+    if (bus.smbusInit(busID) == -1)
+    {
+        return false;
+    }
+    auto exist = bus.smbusCheckSlave(busID, addr);
+    bus.smbusClose(busID);
+    return exist;
+}
+
+bool ioExpander::load()
+{
+    auto bus = phosphor::smbus::Smbus();
+    if (bus.smbusInit(busID) == -1)
+    {
+        return false;
+    }
+    if (bus.smbusLock(busID) < 0)
+    {
+        bus.smbusClose(busID);
+        return false;
+    }
+    auto direction = bus.GetSmbusCmdByte(busID, addr, IO_EXPANDER_COMMAND_3);
+    auto output = bus.GetSmbusCmdByte(busID, addr, IO_EXPANDER_COMMAND_1);
+    if (direction >= 0 && output >= 0)
+    {
+        shadowDirection = direction;
+        shadowOutput = output;
+        valid = true;
+    }
+    bus.smbusUnlock(busID);
+    bus.smbusClose(busID);
+    return direction >= 0 && output >= 0;
+}
+
+void ioExpander::restore(uint8_t direction, uint8_t output)
+{
+    shadowDirection = direction;
+    shadowOutput = output;
+    valid = true;
+}
+
+bool ioExpander::write(uint8_t reg, uint8_t value, uint8_t& shadow)
+{
+    auto bus = phosphor::smbus::Smbus();
+    if (bus.smbusInit(busID) == -1)
+    {
+        return false;
+    }
+    auto res = bus.SetSmbusCmdByte(busID, addr, reg, value);
+    bus.smbusClose(busID);
+    if (res < 0)
+    {
+        return false;
+    }
+    shadow = value;
+    return true;
+}
+
+bool ioExpander::setDirection(uint8_t mask, bool input)
+{
+    if (!valid)
+    {
+        return false;
+    }
+    uint8_t value = (input) ? (shadowDirection | mask)
+                            : (shadowDirection & ~mask);
+    if (value == shadowDirection)
+    {
+        return true;
+    }
+    return write(IO_EXPANDER_COMMAND_3, value, shadowDirection);
+}
+
+bool ioExpander::setOutput(uint8_t mask, bool high)
+{
+    if (!valid)
+    {
+        return false;
+    }
+    uint8_t value = (high) ? (shadowOutput | mask) : (shadowOutput & ~mask);
+    if (value == shadowOutput)
+    {
+        return true;
+    }
+    return write(IO_EXPANDER_COMMAND_1, value, shadowOutput);
+}
+
+bool ioExpander::verify()
+{
+    if (!valid)
+    {
+        return false;
+    }
+    auto bus = phosphor::smbus::Smbus();
+    if (bus.smbusInit(busID) == -1)
+    {
+        return false;
+    }
+    if (bus.smbusLock(busID) < 0)
+    {
+        bus.smbusClose(busID);
+        return false;
+    }
+    auto direction = bus.GetSmbusCmdByte(busID, addr, IO_EXPANDER_COMMAND_3);
+    auto output = bus.GetSmbusCmdByte(busID, addr, IO_EXPANDER_COMMAND_1);
+    auto err = errno;
+    bus.smbusUnlock(busID);
+    bus.smbusClose(busID);
+
+    if (direction < 0 || output < 0)
+    {
+        ratelimit::error("Failed to read IO expander", busID, addr, err);
+        return false;
+    }
+    return (uint8_t)direction == shadowDirection &&
+           (uint8_t)output == shadowOutput;
+}
+
+bool ioExpander::repair()
+{
+    if (!valid)
+    {
+        return false;
+    }
+    auto bus = phosphor::smbus::Smbus();
+    if (bus.smbusInit(busID) == -1)
+    {
+        return false;
+    }
+    if (bus.smbusLock(busID) < 0)
+    {
+        bus.smbusClose(busID);
+        return false;
+    }
+    auto res = bus.SetSmbusCmdByte(busID, addr, IO_EXPANDER_COMMAND_1,
+                                   shadowOutput);
+    if (res >= 0)
+    {
+        res = bus.SetSmbusCmdByte(busID, addr, IO_EXPANDER_COMMAND_3,
+                                  shadowDirection);
+    }
+    bus.smbusUnlock(busID);
+    bus.smbusClose(busID);
+    return res >= 0;
+}
+}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+/** @class ioExpander
+ *  @brief 8 line IO expander of a card, with shadow registers.
+ *
+ *  The direction (register 3, a set bit is an input) and output
+ *  (register 1) registers are kept in shadow copies once loaded, changing
+ *  a line is a single register write without reading it back first.
+ *  verify() compares the shadows against the hardware and repair() writes
+ *  them again, e.g. after the expander lost power.
+ *
+ *  Each call holds the bus lock, callers lock it around sequences that
+ *  must not be interleaved with other writers.
+ */
+class ioExpander
+{
+  public:
+    ioExpander() = delete;
+
+    /** @brief Constructs ioExpander, the hardware isn't touched
+     *
+     * @param[in] busID - I2C bus of the card
+     * @param[in] addr  - Address of the expander
+     */
+    ioExpander(uint8_t busID, uint8_t addr) : busID(busID), addr(addr)
+    {
+    }
+
+    /** @brief Whether the expander acknowledges its address */
+    bool present();
+
+    /** @brief Read both registers into the shadows
+     *
+     * @return false if a read failed, the shadows are left unloaded
+     */
+    bool load();
+
+    /** @brief Take the shadows from a previous run, verify() tells whether
+     *         the hardware still matches them.
+     */
+    void restore(uint8_t direction, uint8_t output);
+
+    /** @brief Configure lines as inputs or outputs, one write unless the
+     *         shadow already matches. Needs loaded shadows.
+     *
+     * @param[in] mask  - Lines to configure
+     * @param[in] input - Input if true, output otherwise
+     */
+    bool setDirection(uint8_t mask, bool input);
+
+    /** @brief Drive output lines high or low, one write unless the shadow
+     *         already matches. Needs loaded shadows.
+     */
+    bool setOutput(uint8_t mask, bool high);
+
+    /** @brief Read both registers back and compare them to the shadows
+     *
+     * @return false on mismatch or read failure
+     */
+    bool verify();
+
+    /** @brief Write the shadows to the hardware, output first so no line
+     *         glitches when it turns into an output.
+     */
+    bool repair();
+
+    bool loaded() const
+    {
+        return valid;
+    }
+    uint8_t direction() const
+    {
+        return shadowDirection;
+    }
+    uint8_t output() const
+    {
+        return shadowOutput;
+    }
+
+  private:
+    /** @brief Write a register and update its shadow on success */
+    bool write(uint8_t reg, uint8_t value, uint8_t& shadow);
+
+    uint8_t busID;
+    uint8_t addr;
+    bool valid = false;
+    uint8_t shadowDirection = 0xff;
+    uint8_t shadowOutput = 0xff;
+};
+}
+}
@@ -5,6 +5,15 @@
 #include <sdbusplus/sdbus.hpp>
 #include <sdbusplus/server/manager.hpp>
 
+#include <signal.h>
+
+/** @brief Leave the event loop, so buffered samples get flushed */
+static int onTerminate(sd_event_source* source, const struct signalfd_siginfo*,
+                       void*)
+{
+    return sd_event_exit(sd_event_source_get_event(source), 0);
+}
+
 int main(void)
 {
     sdbusplus::bus::bus bus = sdbusplus::bus::new_default();
@@ -19,6 +28,15 @@ int main(void)
     // attach bus to this event loop
     bus.attach_event(sdEvent.get(), SD_EVENT_PRIORITY_NORMAL);
 
+    // signals are handled by the event loop, block them before any thread
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    sd_event_add_signal(sdEvent.get(), nullptr, SIGTERM, onTerminate, nullptr);
+    sd_event_add_signal(sdEvent.get(), nullptr, SIGINT, onTerminate, nullptr);
+
     sdbusplus::server::manager::manager objManager(bus, BITTWARE_SOC_OBJ_PATH_ROOT);
 
     phosphor::mpSOC::bittwareManager objMgr(bus);
@@ -1,143 +1,847 @@
 #include "config.h"
 #include "manager.hpp"
-#include "nlohmann/json.hpp"
+#include "ratelimit.hpp"
+#include "smbus.hpp"
 
-#include <fstream>
-#include <iostream>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
-#define MONITOR_INTERVAL_SECONDS 1
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <set>
 
+static constexpr auto configDir = "/etc/bittware";
+static constexpr auto configName = "bittware_config.json";
 static constexpr auto configFile = "/etc/bittware/bittware_config.json";
-using Json = nlohmann::json;
 
 namespace phosphor
 {
 namespace mpSOC
 {
-void bittwareManager::read()
+void bittwareManager::read(const std::vector<uint8_t>& due)
 {
-    for (auto it = devs.begin(); it != devs.end(); it++)
+    auto start = std::chrono::steady_clock::now();
+    auto budget = std::chrono::milliseconds(cycleBudget);
+    auto cycleTime = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+    uint64_t switches = 0;
+
+    /* Already ordered by the scheduler, cards near their limits first and
+     * grouped by mux channel. Cards the budget skipped last time go right
+     * after the near-limit ones, a slow card can't starve those behind it.
+     */
+    auto order = due;
+    std::stable_partition(order.begin(), order.end(), [this](uint8_t id) {
+        auto dev = findCard(id);
+        return (dev && dev->urgency() > 0) || skippedCycles.count(id);
+    });
+    std::stable_partition(order.begin(), order.end(), [this](uint8_t id) {
+        auto dev = findCard(id);
+        return dev && dev->urgency() > 0;
+    });
+    auto smbus = phosphor::smbus::Smbus();
+    /* Buses background work such as VPD reads is held off for the rest of
+     * the cycle.
+     */
+    std::set<int> heldBuses;
+
+    for (auto id : order)
     {
-        if ((*it)->present)
+        auto dev = findCard(id);
+        if (!dev || !dev->present)
+        {
+            continue;
+        }
+        auto busID = dev->getConfig().busID;
+        auto overBudget = cycleBudget > 0 &&
+                          std::chrono::steady_clock::now() - start > budget;
+        /* Over budget, cards far from their limits wait for their next
+         * deadline so the cycle time stays bounded.
+         */
+        if (overBudget && dev->urgency() == 0)
+        {
+            stats.skippedReads++;
+            if (++skippedCycles[id] >= CYCLE_SKIPS_STALE)
+            {
+                dev->markStale();
+            }
+            continue;
+        }
+        skippedCycles.erase(id);
+        if (overBudget && heldBuses.insert(busID).second)
+        {
+            smbus.smbusUrgentBegin(busID);
+        }
+        if (muxTopology.locate(busID).muxAddr != 0)
+        {
+            auto mux = muxTopology.orderKey(busID) & ~0xffu;
+            auto channel = muxChannels.find(mux);
+            if (channel == muxChannels.end() || channel->second != busID)
+            {
+                switches++;
+                muxChannels[mux] = busID;
+            }
+        }
+        auto wasBursting = dev->bursting();
+        dev->read(overBudget);
+        pollScheduler.setUrgency(id, dev->urgency());
+        if (dev->bursting() != wasBursting)
         {
-            (*it)->read();
+            pollScheduler.schedule(
+                id, std::chrono::milliseconds(dev->pollInterval()),
+                dev->getConfig().priority);
+        }
+        if (sampleLog)
+        {
+            auto r = dev->reading();
+            sampleLog->add(cycleTime, r.index, r.value, r.present,
+                           r.functional);
         }
     }
+    for (auto busID : heldBuses)
+    {
+        smbus.smbusUrgentEnd(busID);
+    }
+    stats.cycleMuxSwitches = switches;
+    stats.muxSwitches += switches;
+    cycleDuration.observe(std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count());
+    ratelimit::flush();
+
+    /* Flash sees one append per interval */
+    if (sampleLog && start - sampleLogFlushed >= sampleLogFlushInterval)
+    {
+        sampleLog->flush();
+        sampleLogFlushed = start;
+    }
+
+    if (start - checkpointed >= std::chrono::seconds(CHECKPOINT_INTERVAL_SECONDS))
+    {
+        saveCheckpoint();
+    }
+
+    std::vector<cardReading> snapshot;
+    snapshot.reserve(devs.size());
+    for (auto it = devs.begin(); it != devs.end(); it++)
+    {
+        snapshot.push_back((*it)->reading());
+    }
+    for (auto& aggregate : aggregates)
+    {
+        aggregate->update(snapshot);
+    }
+    if (telemetryExport)
+    {
+        telemetryExport->update(snapshot);
+    }
+    allReadings.update(std::move(snapshot));
+}
+
+std::shared_ptr<bittwareSOC> bittwareManager::findCard(uint8_t index) const
+{
+    auto found = std::find_if(devs.begin(), devs.end(),
+                              [index](const std::shared_ptr<bittwareSOC>& dev) {
+                                  return dev->getIndex() == index;
+                              });
+    return (found != devs.end()) ? *found : nullptr;
+}
+
+void bittwareManager::saveCheckpoint()
+{
+    /* Cards being brought up are in devs before their VPD is read */
+    if (replaying || pendingVPD > 0)
+    {
+        return;
+    }
+
+    std::vector<checkpoint::card> cards;
+    for (const auto& dev : devs)
+    {
+        cards.push_back(dev->checkpointState());
+    }
+    checkpoint::save(CHECKPOINT_PATH, cards);
+    checkpointed = std::chrono::steady_clock::now();
 }
 
 void bittwareManager::run()
 {
     init();
+}
 
-    std::function<void()> callback(std::bind(&bittwareManager::read, this));
-    try
+void bittwareManager::applyBusPolicies(const daemonConfig& config)
+{
+    auto smbus = phosphor::smbus::Smbus();
+    /* Timeout and retries only take effect on the root adapter. Channels of
+     * one mux share it, the shortest timeout and fewest retries win.
+     */
+    std::map<int, std::pair<int, int>> adapters;
+    auto stricter = [](int a, int b) {
+        return (a < 0) ? b : (b < 0) ? a : std::min(a, b);
+    };
+    for (const auto& policy : config.buses)
     {
-        u_int64_t interval = MONITOR_INTERVAL_SECONDS * 1000000;
-        _timer.restart(std::chrono::microseconds(interval));
+        auto parent = muxTopology.locate(policy.busID).parentBus;
+        auto found = adapters.emplace(parent, std::make_pair(-1, -1)).first;
+        found->second.first = stricter(found->second.first, policy.timeout);
+        found->second.second = stricter(found->second.second, policy.retries);
+        /* The lock is held per channel */
+        smbus.smbusSetLockFile(policy.busID, policy.lockFile.c_str(),
+                               (policy.lockTimeout < 0) ? BUS_LOCK_TIMEOUT_MS
+                                                        : policy.lockTimeout);
     }
-    catch (const std::exception& e)
+    for (const auto& [bus, settings] : adapters)
     {
-        std::cerr << "Error in polling loop. ERROR = " << e.what() << std::endl;
+        smbus.smbusSetPolicy(bus, settings.first, settings.second);
     }
+    cycleBudget = config.cycleBudget;
 }
 
-Json parseSensorConfig()
+void bittwareManager::initTrace(const daemonConfig& config)
 {
-    std::ifstream jsonFile(configFile);
-    if (!jsonFile.is_open())
+    auto smbus = phosphor::smbus::Smbus();
+    const auto& trace = config.trace;
+
+    if (trace.mode == traceConfig::type::record)
     {
-        std::cerr << "Bittware config JSON file not found" << std::endl;
+        if (smbus.smbusRecord(trace.path.c_str()) == 0)
+        {
+            std::cout << "Recording I2C transactions to " << trace.path
+                      << std::endl;
+        }
+    }
+    else if (trace.mode == traceConfig::type::replay)
+    {
+        if (smbus.smbusReplay(trace.path.c_str(), trace.speed) == 0)
+        {
+            std::cout << "Replaying I2C transactions from " << trace.path
+                      << std::endl;
+            /* Only i2c-dev transactions are in the trace */
+            backend.mode = backendConfig::type::i2cdev;
+            replaying = true;
+        }
     }
+}
 
-    auto data = Json::parse(jsonFile, nullptr, false);
-    if (data.is_discarded())
+/** @brief Map the shared memory telemetry region if it's enabled */
+void bittwareManager::initTelemetry(const daemonConfig& config)
+{
+    if (!config.telemetryEnabled)
     {
-        std::cerr << "Bittware config readings JSON parser failure" << std::endl;
+        return;
     }
+    telemetryExport = std::make_unique<telemetry::writer>(config.telemetryPath);
+    if (!telemetryExport->ready())
+    {
+        telemetryExport.reset();
+    }
+}
 
-    return data;
+static bool sameAggregate(const aggregateConfig& a, const aggregateConfig& b)
+{
+    return a.name == b.name && a.type == b.type && a.cards == b.cards &&
+           a.weights == b.weights;
 }
 
-/** @brief Obtain the initial configuration value of Bittware  */
-std::vector<phosphor::mpSOC::bittwareSOC::bittwareConfig> getBittwareConfig()
+void bittwareManager::initAggregates(
+    const std::vector<aggregateConfig>& configs)
 {
-    phosphor::mpSOC::bittwareSOC::bittwareConfig bittwareConfig;
-    std::vector<phosphor::mpSOC::bittwareSOC::bittwareConfig> bittwareConfigs;
-    uint64_t criticalHigh = 0;
-    uint64_t criticalLow = 0;
-    uint64_t maxValue = 0;
-    uint64_t minValue = 0;
-    uint64_t warningHigh = 0;
-    uint64_t warningLow = 0;
+    if (configs.size() == aggregates.size() &&
+        std::equal(configs.begin(), configs.end(), aggregates.begin(),
+                   [](const aggregateConfig& c,
+                      const std::unique_ptr<aggregateSensor>& a) {
+                       return sameAggregate(c, a->getConfig());
+                   }))
+    {
+        return;
+    }
 
-    try
+    /* Objects of renamed sensors must be gone before new ones are added */
+    aggregates.clear();
+    for (const auto& config : configs)
     {
-        auto data = parseSensorConfig();
-        static const std::vector<Json> empty{};
-        std::vector<Json> readings = data.value("config", empty);
-        std::vector<Json> thresholds = data.value("threshold", empty);
-        if (!thresholds.empty())
+        auto path =
+            std::string(BITTWARE_SOC_OBJ_PATH_ROOT) + "/" + config.name;
+        aggregates.push_back(
+            std::make_unique<aggregateSensor>(bus, path, config));
+    }
+}
+
+void bittwareManager::initSampleLog(const daemonConfig& config)
+{
+    if (!config.sampleLogEnabled)
+    {
+        return;
+    }
+    sampleLog = std::make_unique<samplelog::writer>(
+        config.sampleLogPath, config.sampleLogMaxSize, config.sampleLogSegments);
+    if (!sampleLog->ready())
+    {
+        sampleLog.reset();
+        return;
+    }
+    sampleLogFlushInterval = std::chrono::seconds(config.sampleLogFlushInterval);
+    sampleLogFlushed = std::chrono::steady_clock::now();
+}
+
+void bittwareManager::initMetrics(const daemonConfig& config)
+{
+    if (!config.metricsEnabled)
+    {
+        return;
+    }
+    metricsServer = std::make_unique<metrics::server>(
+        _event.get(), config.metricsPath, [this]() { return renderMetrics(); });
+    if (!metricsServer->ready())
+    {
+        metricsServer.reset();
+    }
+}
+
+std::string bittwareManager::renderMetrics() const
+{
+    std::string out;
+    auto smbus = phosphor::smbus::Smbus();
+
+    auto cardLabel = [](int index) {
+        return "card=\"" + std::to_string(index) + "\"";
+    };
+    auto busLabel = [](int busID) {
+        return "bus=\"" + std::to_string(busID) + "\"";
+    };
+
+    std::vector<cardReading> cards;
+    for (const auto& dev : devs)
+    {
+        cards.push_back(dev->reading());
+    }
+    metrics::family(out, "bittware_card_present", "gauge",
+                    "Whether the card has been detected");
+    for (const auto& c : cards)
+    {
+        metrics::sample(out, "bittware_card_present", cardLabel(c.index),
+                        c.present);
+    }
+    metrics::family(out, "bittware_card_functional", "gauge",
+                    "Whether the last read of the card succeeded");
+    for (const auto& c : cards)
+    {
+        metrics::sample(out, "bittware_card_functional", cardLabel(c.index),
+                        c.functional);
+    }
+    metrics::family(out, "bittware_temperature_celsius", "gauge",
+                    "Temperature of the card");
+    for (const auto& c : cards)
+    {
+        if (c.present && c.functional)
+        {
+            /* Sensor.Value of the cards has scale -4 */
+            metrics::sample(out, "bittware_temperature_celsius",
+                            cardLabel(c.index), c.value * 1e-4);
+        }
+    }
+
+    std::set<int> buses;
+    for (const auto& config : configs)
+    {
+        buses.insert(config.busID);
+    }
+    std::vector<double> bounds(std::begin(phosphor::smbus::latencyBucketsUsec),
+                               std::end(phosphor::smbus::latencyBucketsUsec));
+    for (auto& b : bounds)
+    {
+        b *= 1e-6;
+    }
+    std::map<int, phosphor::smbus::SmbusStats> busStats;
+    for (auto busID : buses)
+    {
+        busStats[busID] = smbus.smbusGetStats(busID);
+    }
+    metrics::family(out, "bittware_i2c_transactions_total", "counter",
+                    "I2C transactions made on the bus");
+    for (const auto& s : busStats)
+    {
+        metrics::sample(out, "bittware_i2c_transactions_total",
+                        busLabel(s.first), s.second.transactions);
+    }
+    metrics::family(out, "bittware_i2c_errors_total", "counter",
+                    "Failed I2C transactions, NAKs included");
+    for (const auto& s : busStats)
+    {
+        metrics::sample(out, "bittware_i2c_errors_total", busLabel(s.first),
+                        s.second.errors);
+    }
+    metrics::family(out, "bittware_i2c_naks_total", "counter",
+                    "I2C transactions not acknowledged by the device");
+    for (const auto& s : busStats)
+    {
+        metrics::sample(out, "bittware_i2c_naks_total", busLabel(s.first),
+                        s.second.naks);
+    }
+    metrics::family(out, "bittware_i2c_latency_seconds", "histogram",
+                    "Duration of the I2C transactions");
+    for (const auto& s : busStats)
+    {
+        metrics::histogram h(bounds);
+        std::copy(std::begin(s.second.latency), std::end(s.second.latency),
+                  h.counts.begin());
+        h.sum = s.second.latencySumUsec * 1e-6;
+        h.count = s.second.transactions;
+        metrics::sample(out, "bittware_i2c_latency_seconds", busLabel(s.first),
+                        h);
+    }
+    metrics::family(out, "bittware_i2c_lock_wait_seconds_total", "counter",
+                    "Time spent waiting for other processes on the bus lock");
+    for (auto busID : buses)
+    {
+        metrics::sample(out, "bittware_i2c_lock_wait_seconds_total",
+                        busLabel(busID), smbus.smbusLockWaitUsec(busID) * 1e-6);
+    }
+
+    metrics::family(out, "bittware_poll_cycle_duration_seconds", "histogram",
+                    "Time spent reading the due cards of a poll cycle");
+    metrics::sample(out, "bittware_poll_cycle_duration_seconds", "",
+                    cycleDuration);
+    metrics::family(out, "bittware_skipped_reads_total", "counter",
+                    "Reads skipped because the cycle budget was exhausted");
+    metrics::sample(out, "bittware_skipped_reads_total", "", stats.skippedReads);
+    metrics::family(out, "bittware_mux_switches_total", "counter",
+                    "I2C mux channel switches caused by the reads");
+    metrics::sample(out, "bittware_mux_switches_total", "", stats.muxSwitches);
+    metrics::family(out, "bittware_mux_switches_last_cycle", "gauge",
+                    "I2C mux channel switches of the last poll cycle");
+    metrics::sample(out, "bittware_mux_switches_last_cycle", "",
+                    stats.cycleMuxSwitches);
+
+    /* Latest run of each phase, reloads bring cards up again */
+    std::map<std::pair<int, std::string>, double> phases;
+    int64_t startupEnd = 0;
+    for (const auto& p : startup.get())
+    {
+        phases[{p.card, p.name}] =
+            std::chrono::duration<double>(p.end - p.start).count();
+        startupEnd = std::max(startupEnd, startup.offset(p.end));
+    }
+    metrics::family(out, "bittware_startup_phase_seconds", "gauge",
+                    "Duration of a bring-up phase of the card, vpd included");
+    for (const auto& p : phases)
+    {
+        metrics::sample(out, "bittware_startup_phase_seconds",
+                        cardLabel(p.first.first) + ",phase=\"" +
+                            p.first.second + "\"",
+                        p.second);
+    }
+    if (startupDone)
+    {
+        metrics::family(out, "bittware_startup_seconds", "gauge",
+                        "Time from daemon start until all cards were up");
+        metrics::sample(out, "bittware_startup_seconds", "",
+                        startupEnd * 1e-3);
+    }
+
+    return out;
+}
+
+bittwareManager::~bittwareManager()
+{
+    for (auto& worker : workers)
+    {
+        if (worker.joinable())
         {
-            for (const auto& instance : thresholds)
+            worker.join();
+        }
+    }
+    saveCheckpoint();
+    postedEvent.reset();
+    if (postedFd >= 0)
+    {
+        close(postedFd);
+    }
+    configEvent.reset();
+    if (inotifyFd >= 0)
+    {
+        close(inotifyFd);
+    }
+}
+
+void bittwareManager::init()
+{
+    // read json file
+    auto config = parseConfig(configFile);
+    configs = config.cards;
+    backend = config.backend;
+    muxTopology = i2cTopology(backend.sysfsRoot);
+    initTrace(config);
+    if (!replaying)
+    {
+        savedState = checkpoint::load(CHECKPOINT_PATH);
+    }
+    applyBusPolicies(config);
+    burstSettings = config.burst;
+    initTelemetry(config);
+    initAggregates(config.aggregates);
+    initSampleLog(config);
+    initMetrics(config);
+
+    postedFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (postedFd >= 0)
+    {
+        postedEvent = std::make_unique<sdeventplus::source::IO>(
+            _event, postedFd, EPOLLIN,
+            [this](sdeventplus::source::IO&, int, uint32_t) { runPosted(); });
+    }
+    else
+    {
+        std::cerr << "Failed to create eventfd, initializing sequentially"
+                  << std::endl;
+    }
+
+    watchConfig();
+    bringUp(configs);
+}
+
+void bittwareManager::bringUp(const std::vector<bittwareSOC::bittwareConfig>& cards)
+{
+    /* Cards sharing a bus are brought up one after another by one worker,
+     * so are the channels of a mux as the kernel serializes them anyway.
+     * A worker goes through the cards one mux channel after another.
+     */
+    std::map<int, std::vector<std::shared_ptr<bittwareSOC>>> buses;
+    for (auto it = cards.begin(); it != cards.end(); it++)
+    {
+        auto dev = std::make_shared<phosphor::mpSOC::bittwareSOC>(
+            it->index, bus, *it, backend);
+        auto saved = savedState.find(it->index);
+        if (saved != savedState.end())
+        {
+            if (saved->second.busID == it->busID)
             {
-                criticalHigh = instance.value("criticalHigh", 0);
-                criticalLow = instance.value("criticalLow", 0);
-                maxValue = instance.value("maxValue", 0);
-                minValue = instance.value("minValue", 0);
-                warningHigh = instance.value("warningHigh", 0);
-                warningLow = instance.value("warningLow", 0);
+                dev->restoreFrom(saved->second);
             }
+            savedState.erase(saved);
         }
-        else
+        buses[muxTopology.locate(it->busID).parentBus].push_back(dev);
+        bringingUp.push_back(dev);
+    }
+    for (auto& group : buses)
+    {
+        std::stable_sort(group.second.begin(), group.second.end(),
+                         [this](const std::shared_ptr<bittwareSOC>& a,
+                                const std::shared_ptr<bittwareSOC>& b) {
+                             return muxTopology.orderKey(a->getConfig().busID) <
+                                    muxTopology.orderKey(b->getConfig().busID);
+                         });
+    }
+    pendingCards += cards.size();
+    pendingVPD += cards.size();
+
+    if (postedFd < 0)
+    {
+        for (auto& group : buses)
         {
-            std::cerr << "Invalid config file, thresholds dosen't exist"
-                      << std::endl;
+            for (auto& dev : group.second)
+            {
+                dev->probe(startup);
+                cardPresent(dev);
+            }
+        }
+        for (auto& group : buses)
+        {
+            for (auto& dev : group.second)
+            {
+                dev->readVPD(startup);
+                cardVPDRead();
+            }
+        }
+        return;
+    }
+
+    for (auto& group : buses)
+    {
+        auto busCards = group.second;
+        workers.emplace_back([this, busCards]() {
+            /* Stage 1: presence, sensors are published as soon as possible */
+            for (auto& dev : busCards)
+            {
+                dev->probe(startup);
+                postToLoop([this, dev]() { cardPresent(dev); });
+            }
+            /* Stage 2: VPD, it shares the bus with the polling and yields
+             * to it between EEPROM chunks.
+             */
+            for (auto& dev : busCards)
+            {
+                dev->readVPD(startup);
+                postToLoop([this]() { cardVPDRead(); });
+            }
+        });
+    }
+}
+
+void bittwareManager::watchConfig()
+{
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+    {
+        std::cerr << "Failed to init inotify, config reload disabled"
+                  << std::endl;
+        return;
+    }
+
+    /* Watch the directory, editors and package updates replace the file */
+    if (inotify_add_watch(inotifyFd, configDir, IN_CLOSE_WRITE | IN_MOVED_TO) <
+        0)
+    {
+        std::cerr << "Failed to watch " << configDir
+                  << ", config reload disabled" << std::endl;
+        close(inotifyFd);
+        inotifyFd = -1;
+        return;
+    }
+
+    configEvent = std::make_unique<sdeventplus::source::IO>(
+        _event, inotifyFd, EPOLLIN,
+        [this](sdeventplus::source::IO&, int, uint32_t) { configChanged(); });
+}
+
+void bittwareManager::configChanged()
+{
+    alignas(struct inotify_event) char buf[4096];
+    bool changed = false;
+    ssize_t len;
+
+    while ((len = ::read(inotifyFd, buf, sizeof(buf))) > 0)
+    {
+        for (char* p = buf; p < buf + len;)
+        {
+            auto event = reinterpret_cast<struct inotify_event*>(p);
+            if (event->len && std::string(event->name) == configName)
+            {
+                changed = true;
+            }
+            p += sizeof(struct inotify_event) + event->len;
         }
+    }
+
+    if (changed)
+    {
+        reloadConfig();
+    }
+}
+
+/** @brief Whether a card has to be brought up again for the new config */
+static bool sameCard(const bittwareSOC::bittwareConfig& a,
+                     const bittwareSOC::bittwareConfig& b)
+{
+    return a.index == b.index && a.busID == b.busID;
+}
+
+static bool samePolicy(const bittwareSOC::bittwareConfig& a,
+                       const bittwareSOC::bittwareConfig& b)
+{
+    return a.criticalHigh == b.criticalHigh && a.criticalLow == b.criticalLow &&
+           a.maxValue == b.maxValue && a.minValue == b.minValue &&
+           a.warningHigh == b.warningHigh && a.warningLow == b.warningLow &&
+           a.pollInterval == b.pollInterval &&
+           a.alarmInterval == b.alarmInterval && a.deadband == b.deadband &&
+           a.priority == b.priority && a.margin == b.margin;
+}
 
-        if (!readings.empty())
+void bittwareManager::reloadConfig()
+{
+    /* Cards of the running bring-up aren't in devs yet, diff afterwards */
+    if (pendingVPD > 0)
+    {
+        reloadPending = true;
+        return;
+    }
+    reloadPending = false;
+
+    auto parsed = parseConfig(configFile);
+    if (!parsed.valid)
+    {
+        std::cerr << "Keep running Bittware config" << std::endl;
+        return;
+    }
+    const auto& newConfigs = parsed.cards;
+    backend = parsed.backend;
+    if (replaying)
+    {
+        backend.mode = backendConfig::type::i2cdev;
+    }
+    applyBusPolicies(parsed);
+    initAggregates(parsed.aggregates);
+
+    for (auto it = devs.begin(); it != devs.end();)
+    {
+        const auto& old = (*it)->getConfig();
+        auto found = std::find_if(
+            newConfigs.begin(), newConfigs.end(),
+            [&old](const bittwareSOC::bittwareConfig& c) {
+                return c.index == old.index;
+            });
+
+        if (found == newConfigs.end() || !sameCard(old, *found))
+        {
+            std::cout << "Removing Bittware " << (int)old.index << std::endl;
+            removeInventory(*it);
+            pollScheduler.unschedule(old.index);
+            it = devs.erase(it);
+            continue;
+        }
+        auto wasBursting = (*it)->bursting();
+        (*it)->setBurst(parsed.burst);
+        if (!samePolicy(old, *found) || (*it)->bursting() != wasBursting)
         {
-            for (const auto& instance : readings)
+            std::cout << "Updating Bittware " << (int)old.index << std::endl;
+            (*it)->reconfigure(*found);
+            if ((*it)->present)
             {
-                uint8_t index = instance.value("bittwareIndex", 0);
-                uint8_t busID = instance.value("bittwareBusID", 0);
-
-                bittwareConfig.index = index;
-                bittwareConfig.busID = busID;
-                bittwareConfig.criticalHigh = criticalHigh;
-                bittwareConfig.criticalLow = criticalLow;
-                bittwareConfig.warningHigh = warningHigh;
-                bittwareConfig.warningLow = warningLow;
-                bittwareConfig.maxValue = maxValue;
-                bittwareConfig.minValue = minValue;
-                bittwareConfigs.push_back(bittwareConfig);
+                pollScheduler.schedule(
+                    old.index, std::chrono::milliseconds((*it)->pollInterval()),
+                    found->priority);
             }
         }
-        else
+        it++;
+    }
+
+    std::vector<bittwareSOC::bittwareConfig> added;
+    for (const auto& config : newConfigs)
+    {
+        auto found = std::find_if(
+            devs.begin(), devs.end(),
+            [&config](const std::shared_ptr<bittwareSOC>& dev) {
+                return dev->getConfig().index == config.index;
+            });
+        if (found == devs.end())
         {
-            std::cerr << "Invalid Bittware config file, config dosen't exist"
-                      << std::endl;
+            std::cout << "Adding Bittware " << (int)config.index << std::endl;
+            added.push_back(config);
         }
     }
-    catch (const Json::exception& e)
+
+    configs = newConfigs;
+    burstSettings = parsed.burst;
+    if (!added.empty())
     {
-        std::cerr << "Json Exception caught. MSG: " << e.what() << std::endl;
+        bringUp(added);
     }
+}
 
-    return bittwareConfigs;
+void bittwareManager::postToLoop(std::function<void()> work)
+{
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        posted.push_back(std::move(work));
+    }
+    uint64_t one = 1;
+    if (write(postedFd, &one, sizeof(one)) < 0)
+    {
+        std::cerr << "Failed to signal event loop" << std::endl;
+    }
 }
 
-void bittwareManager::init()
+void bittwareManager::runPosted()
 {
-    // read json file
-    configs = getBittwareConfig();
-    for (auto it = configs.begin(); it != configs.end(); it++)
+    uint64_t count;
+    if (::read(postedFd, &count, sizeof(count)) < 0)
     {
-        std::cout << "Initializing Bittware " << (int)it->index << std::endl;
-        auto dev = std::make_shared<phosphor::mpSOC::bittwareSOC>(
-            it->index, bus, *it);
-        devs.push_back(dev);
-        std::cout << "Bittware " << (int)it->index << " initialized" << std::endl;
+        return;
+    }
+
+    std::vector<std::function<void()>> work;
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        work.swap(posted);
+    }
+
+    for (auto& w : work)
+    {
+        w();
     }
 }
+
+void bittwareManager::cardPresent(const std::shared_ptr<bittwareSOC>& dev)
+{
+    dev->publish(startup);
+    devs.push_back(dev);
+    if (dev->present)
+    {
+        auto index = dev->getIndex();
+        dev->setBurst(burstSettings);
+        dev->watchAlarms(_event, [this, index]() { alarmRaised(index); });
+        pollScheduler.setGroup(index,
+                               muxTopology.orderKey(dev->getConfig().busID));
+        pollScheduler.schedule(index,
+                               std::chrono::milliseconds(dev->pollInterval()),
+                               dev->getConfig().priority);
+    }
+    pendingCards--;
+    std::cout << "Bittware " << (int)dev->getIndex() << " initialized"
+              << std::endl;
+}
+
+void bittwareManager::alarmRaised(uint8_t index)
+{
+    read({index});
+}
+
+void bittwareManager::cardVPDRead()
+{
+    if (--pendingVPD > 0)
+    {
+        return;
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+    publishInventory(bringingUp);
+    bringingUp.clear();
+    saveCheckpoint();
+    if (!startupDone)
+    {
+        startupDone = true;
+        startup.dump(std::cout);
+    }
+    if (reloadPending)
+    {
+        reloadConfig();
+    }
+}
+
+void bittwareManager::publishInventory(
+    const std::vector<std::shared_ptr<bittwareSOC>>& cards)
+{
+    inventoryObjects objs;
+    for (const auto& dev : cards)
+    {
+        /* Inventory Manager still holds what the previous run sent */
+        if (!dev->inventoryRestored())
+        {
+            dev->addInventoryObject(objs);
+        }
+    }
+
+    if (!objs.empty())
+    {
+        util::SDBusPlus::CallMethodAsync(dbusCalls, INVENTORY_BUSNAME,
+            INVENTORY_NAMESPACE, INVENTORY_MANAGER_IFACE, "Notify", nullptr,
+            objs);
+    }
+}
+
+void bittwareManager::removeInventory(const std::shared_ptr<bittwareSOC>& dev)
+{
+    std::string path =
+        BITTWARE_SOC_INVENTORY_PATH + std::to_string(dev->getIndex());
+    util::SDBusPlus::setPropertyAsync(dbusCalls, INVENTORY_BUSNAME, path,
+                                      ITEM_IFACE, "Present", false);
+}
 }
 }
\ No newline at end of file
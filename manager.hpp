@@ -1,9 +1,25 @@
+#include "aggregate.hpp"
 #include "bittware_soc.hpp"
+#include "checkpoint.hpp"
+#include "config_parser.hpp"
+#include "i2c_topology.hpp"
+#include "metrics.hpp"
+#include "readings.hpp"
+#include "samplelog.hpp"
+#include "scheduler.hpp"
+#include "sdbusplus.hpp"
+#include "telemetry.hpp"
+#include "timeline.hpp"
 
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sdbusplus/bus.hpp>
-#include <sdeventplus/clock.hpp>
 #include <sdeventplus/event.hpp>
-#include <sdeventplus/utility/timer.hpp>
+#include <sdeventplus/source/io.hpp>
+#include <thread>
+#include <vector>
 
 namespace phosphor
 {
@@ -20,7 +36,7 @@ class bittwareManager
     bittwareManager& operator=(const bittwareManager&) = delete;
     bittwareManager(bittwareManager&&) = delete;
     bittwareManager& operator=(bittwareManager&&) = delete;
-    virtual ~bittwareManager() = default;
+    virtual ~bittwareManager();
 
     /** @brief Constructs bittwareManager
      *
@@ -29,7 +45,9 @@ class bittwareManager
      */
     bittwareManager(sdbusplus::bus::bus& bus) :
         bus(bus), _event(sdeventplus::Event::get_default()),
-        _timer(_event, std::bind(&bittwareManager::read, this))
+        pollScheduler(_event.get(),
+                      [this](const std::vector<uint8_t>& due) { read(due); }),
+        dbusCalls(bus), allReadings(bus, BITTWARE_SOC_MANAGER_PATH)
     {
     }
     /** @brief Setup polling timer in a sd event loop and attach to D-Bus
@@ -41,15 +59,161 @@ class bittwareManager
     sdbusplus::bus::bus& bus;
     /** @brief the Event Loop structure */
     sdeventplus::Event _event;
-    /** @brief Read Timer */
-    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> _timer;
+    /** @brief Per-card poll deadlines */
+    scheduler pollScheduler;
+    /** @brief Outstanding non-blocking calls to other D-Bus services */
+    util::AsyncCallQueue dbusCalls;
+    /** @brief Readings of all cards, refreshed once per poll cycle */
+    readings allReadings;
+    /** @brief Burst sampling applied to every card */
+    burstConfig burstSettings;
+    /** @brief Sensors derived from groups of cards */
+    std::vector<std::unique_ptr<aggregateSensor>> aggregates;
+    /** @brief Publish the derived sensors of the config, the running ones
+     *         are kept if it didn't change.
+     */
+    void initAggregates(const std::vector<aggregateConfig>& configs);
+    /** @brief Optional shared memory export of the readings */
+    std::unique_ptr<telemetry::writer> telemetryExport;
+    /** @brief Cards saved by the previous run, consumed by the first
+     *         bring-up.
+     */
+    std::map<uint8_t, checkpoint::card> savedState;
+    /** @brief Last time the checkpoint was written */
+    std::chrono::steady_clock::time_point checkpointed;
+    /** @brief Checkpoint the state of the cards to /run, so a restarted
+     *         daemon only verifies them. Skipped during bring-up.
+     */
+    void saveCheckpoint();
+    /** @brief Optional persistent log of the samples */
+    std::unique_ptr<samplelog::writer> sampleLog;
+    /** @brief Time between appends to the sample log */
+    std::chrono::seconds sampleLogFlushInterval{0};
+    std::chrono::steady_clock::time_point sampleLogFlushed;
+    /** @brief Optional Prometheus metrics endpoint */
+    std::unique_ptr<metrics::server> metricsServer;
+    /** @brief Time spent in read() per cycle, in seconds */
+    metrics::histogram cycleDuration{
+        {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1}};
     /** @brief Bittware informations parsed from Json file */
     std::vector<phosphor::mpSOC::bittwareSOC::bittwareConfig> configs;
+    /** @brief Cards that finished bring-up, owned by the event loop */
     std::vector<std::shared_ptr<phosphor::mpSOC::bittwareSOC>> devs;
+    /** @brief Per phase and per card timing of the startup */
+    timeline startup;
+    /** @brief One bring-up thread per I2C bus */
+    std::vector<std::thread> workers;
+    /** @brief Cards of the running bring-up, their inventory is published
+     *         once all their VPD has been read.
+     */
+    std::vector<std::shared_ptr<phosphor::mpSOC::bittwareSOC>> bringingUp;
+    /** @brief Whether the startup timeline has been dumped */
+    bool startupDone = false;
+    /** @brief Number of cards whose presence is still being probed */
+    size_t pendingCards = 0;
+    /** @brief Number of cards whose VPD is still being read */
+    size_t pendingVPD = 0;
+    /** @brief Work handed over by the workers to the event loop */
+    std::vector<std::function<void()>> posted;
+    std::mutex postedMutex;
+    /** @brief eventfd signalled by workers when work has been posted */
+    int postedFd = -1;
+    std::unique_ptr<sdeventplus::source::IO> postedEvent;
+    /** @brief inotify watching the config directory */
+    int inotifyFd = -1;
+    std::unique_ptr<sdeventplus::source::IO> configEvent;
+    /** @brief Config changed while cards were being brought up */
+    bool reloadPending = false;
     /** @brief Set up initial configuration value of 250 SoC */
     void init();
-    /** @brief Monitor Bittware 250 SoC every one second  */
-    void read();
+    /** @brief Bring up cards, those behind different muxes or on different
+     *         buses concurrently.
+     *
+     *  Bring-up runs in two stages: presence and sensor creation first, so
+     *  readings flow right away, then VPD and inventory in the background.
+     */
+    void bringUp(const std::vector<bittwareSOC::bittwareConfig>& cards);
+    /** @brief Watch the config file for changes */
+    void watchConfig();
+    /** @brief Handle inotify events of the config directory */
+    void configChanged();
+    /** @brief Apply a changed config, only the cards whose config moved
+     *         are touched.
+     */
+    void reloadConfig();
+    /** @brief Time in milliseconds a poll cycle may spend on cards that
+     *         aren't near their limits, 0 for no limit. Past it the other
+     *         cards are skipped, expander checks are put off and VPD reads
+     *         wait for the end of the cycle. A card skipped
+     *         CYCLE_SKIPS_STALE times in a row is no longer functional.
+     */
+    uint64_t cycleBudget = 0;
+    /** @brief Consecutive cycles each card was skipped for the budget */
+    std::map<uint8_t, uint32_t> skippedCycles;
+    /** @brief Counters of the poll cycles */
+    struct pollStats
+    {
+        /** @brief Reads skipped because the cycle budget was exhausted */
+        uint64_t skippedReads = 0;
+        /** @brief Mux channel switches caused by the reads */
+        uint64_t muxSwitches = 0;
+        /** @brief Mux channel switches of the last cycle */
+        uint64_t cycleMuxSwitches = 0;
+    } stats;
+    /** @brief Access path of the card sensors and EEPROMs, a change on
+     *         reload applies to the cards added by it.
+     */
+    backendConfig backend;
+    /** @brief Mux placement of the card buses */
+    i2cTopology muxTopology;
+    /** @brief Channel bus each mux was last switched to by a read, keyed
+     *         by the mux order key without its channel.
+     */
+    std::map<uint32_t, uint8_t> muxChannels;
+    /** @brief Apply the I2C timeout, retries and lock file of each bus and
+     *         the cycle budget. Adapter settings persist once applied,
+     *         removing a bus from the config doesn't restore the defaults.
+     */
+    void applyBusPolicies(const daemonConfig& config);
+    /** @brief Start recording or replaying the I2C transactions, replay
+     *         forces the i2c-dev backend.
+     */
+    void initTrace(const daemonConfig& config);
+    /** @brief Transactions come from a trace, trace settings aren't
+     *         reloaded.
+     */
+    bool replaying = false;
+    /** @brief Set up the shared memory telemetry export if enabled */
+    void initTelemetry(const daemonConfig& config);
+    /** @brief Open the sample log if enabled */
+    void initSampleLog(const daemonConfig& config);
+    /** @brief Start serving the metrics if enabled */
+    void initMetrics(const daemonConfig& config);
+    /** @brief Current metrics in Prometheus text format */
+    std::string renderMetrics() const;
+    /** @brief Run work on the event loop thread, callable from workers */
+    void postToLoop(std::function<void()> work);
+    /** @brief Run the work posted by the workers */
+    void runPosted();
+    /** @brief Sensor of a probed card is published */
+    void cardPresent(const std::shared_ptr<bittwareSOC>& dev);
+    /** @brief The kernel notified a threshold crossing, read the card now */
+    void alarmRaised(uint8_t index);
+    /** @brief VPD of a card has been read */
+    void cardVPDRead();
+    /** @brief Publish inventory of cards with a single Notify call */
+    void publishInventory(
+        const std::vector<std::shared_ptr<bittwareSOC>>& cards);
+    /** @brief Mark the inventory of a removed card as not present */
+    void removeInventory(const std::shared_ptr<bittwareSOC>& dev);
+    /** @brief Monitor the Bittware 250 SoC cards whose poll interval has
+     *         elapsed.
+     *
+     * @param[in] due - Indexes of the due cards
+     */
+    void read(const std::vector<uint8_t>& due);
+    /** @brief Published card of an index, nullptr if there's none */
+    std::shared_ptr<bittwareSOC> findCard(uint8_t index) const;
 };
 }
 }
\ No newline at end of file
@@ -0,0 +1,279 @@
+#include "metrics.hpp"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+/* Scrapes served at once, further ones wait in the listen backlog */
+#define METRICS_MAX_CONNECTIONS 4
+/* Larger requests aren't a scrape */
+#define METRICS_MAX_REQUEST 4096
+/* A scrape not done by then is dropped, idle peers don't hold a slot */
+#define METRICS_CONNECTION_TIMEOUT_USEC 5000000
+
+namespace phosphor
+{
+namespace mpSOC
+{
+namespace metrics
+{
+void histogram::observe(double value)
+{
+    auto bucket = std::lower_bound(bounds.begin(), bounds.end(), value) -
+                  bounds.begin();
+    counts[bucket]++;
+    sum += value;
+    count++;
+}
+
+void family(std::string& out, const std::string& name, const std::string& type,
+            const std::string& help)
+{
+    out += "# HELP " + name + " " + help + "\n";
+    out += "# TYPE " + name + " " + type + "\n";
+}
+
+static std::string format(double value)
+{
+    std::ostringstream os;
+    os.precision(15);
+    os << value;
+    return os.str();
+}
+
+void sample(std::string& out, const std::string& name,
+            const std::string& labels, double value)
+{
+    out += name;
+    if (!labels.empty())
+    {
+        out += "{" + labels + "}";
+    }
+    out += " " + format(value) + "\n";
+}
+
+void sample(std::string& out, const std::string& name,
+            const std::string& labels, const histogram& h)
+{
+    auto prefix = labels.empty() ? std::string() : labels + ",";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < h.counts.size(); i++)
+    {
+        cumulative += h.counts[i];
+        auto le = (i < h.bounds.size()) ? format(h.bounds[i]) : "+Inf";
+        sample(out, name + "_bucket", prefix + "le=\"" + le + "\"", cumulative);
+    }
+    sample(out, name + "_sum", labels, h.sum);
+    sample(out, name + "_count", labels, h.count);
+}
+
+server::server(sd_event* event, const std::string& path, render fn) :
+    event(event), path(path), fn(std::move(fn))
+{
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        std::cerr << "Metrics socket path too long: " << path << std::endl;
+        return;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    auto dir = path.substr(0, path.find_last_of('/'));
+    if (!dir.empty() && mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST)
+    {
+        std::cerr << "Failed to create " << dir << ": " << strerror(errno)
+                  << std::endl;
+        return;
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+    {
+        std::cerr << "Failed to create metrics socket: " << strerror(errno)
+                  << std::endl;
+        return;
+    }
+    unlink(path.c_str());
+    if (bind(listenFd, reinterpret_cast<struct sockaddr*>(&addr),
+             sizeof(addr)) < 0 ||
+        listen(listenFd, METRICS_MAX_CONNECTIONS) < 0)
+    {
+        std::cerr << "Failed to listen on " << path << ": " << strerror(errno)
+                  << std::endl;
+        close(listenFd);
+        listenFd = -1;
+        return;
+    }
+
+    auto res = sd_event_add_io(event, &listener, listenFd, EPOLLIN,
+                               &server::onAccept, this);
+    if (res < 0)
+    {
+        std::cerr << "Failed to add metrics socket: " << strerror(-res)
+                  << std::endl;
+        listener = nullptr;
+        return;
+    }
+    /* Scrapes wait for polling */
+    sd_event_source_set_priority(listener, SD_EVENT_PRIORITY_IDLE);
+}
+
+server::~server()
+{
+    while (!connections.empty())
+    {
+        drop(connections.back());
+    }
+    if (listener)
+    {
+        sd_event_source_unref(listener);
+    }
+    if (listenFd >= 0)
+    {
+        close(listenFd);
+        unlink(path.c_str());
+    }
+}
+
+int server::onAccept(sd_event_source*, int fd, uint32_t, void* userdata)
+{
+    auto self = static_cast<server*>(userdata);
+
+    while (self->connections.size() < METRICS_MAX_CONNECTIONS)
+    {
+        int peer = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (peer < 0)
+        {
+            break;
+        }
+
+        auto c = new connection{self, peer, nullptr, nullptr, {}, 0, false};
+        uint64_t now = 0;
+        if (sd_event_add_io(self->event, &c->source, peer, EPOLLIN,
+                            &server::onConnection, c) < 0)
+        {
+            close(peer);
+            delete c;
+            continue;
+        }
+        if (sd_event_now(self->event, CLOCK_MONOTONIC, &now) < 0 ||
+            sd_event_add_time(self->event, &c->timer, CLOCK_MONOTONIC,
+                              now + METRICS_CONNECTION_TIMEOUT_USEC, 0,
+                              &server::onTimeout, c) < 0)
+        {
+            sd_event_source_unref(c->source);
+            close(peer);
+            delete c;
+            continue;
+        }
+        sd_event_source_set_priority(c->source, SD_EVENT_PRIORITY_IDLE);
+        self->connections.push_back(c);
+    }
+    /* Stop accepting until a connection is done */
+    sd_event_source_set_enabled(self->listener,
+                                (self->connections.size() <
+                                 METRICS_MAX_CONNECTIONS)
+                                    ? SD_EVENT_ON
+                                    : SD_EVENT_OFF);
+    return 0;
+}
+
+bool server::readRequest(connection* c)
+{
+    char buf[512];
+    ssize_t len;
+
+    while ((len = read(c->fd, buf, sizeof(buf))) > 0)
+    {
+        c->buffer.append(buf, len);
+        if (c->buffer.size() > METRICS_MAX_REQUEST)
+        {
+            return false;
+        }
+    }
+    /* The response doesn't depend on the request, its end is enough */
+    return c->buffer.find("\r\n\r\n") != std::string::npos ||
+           c->buffer.find("\n\n") != std::string::npos || len == 0;
+}
+
+bool server::writeResponse(connection* c)
+{
+    while (c->written < c->buffer.size())
+    {
+        auto len = send(c->fd, c->buffer.data() + c->written,
+                        c->buffer.size() - c->written, MSG_NOSIGNAL);
+        if (len < 0)
+        {
+            return errno != EAGAIN && errno != EINTR;
+        }
+        c->written += len;
+    }
+    return true;
+}
+
+int server::onConnection(sd_event_source*, int, uint32_t revents,
+                         void* userdata)
+{
+    auto c = static_cast<connection*>(userdata);
+
+    if (!c->responding)
+    {
+        if (!readRequest(c))
+        {
+            if (c->buffer.size() > METRICS_MAX_REQUEST ||
+                (revents & (EPOLLHUP | EPOLLERR)))
+            {
+                c->owner->drop(c);
+            }
+            return 0;
+        }
+
+        auto body = c->owner->fn();
+        c->buffer = "HTTP/1.0 200 OK\r\n"
+                    "Content-Type: text/plain; version=0.0.4\r\n"
+                    "Content-Length: " +
+                    std::to_string(body.size()) + "\r\n\r\n" + body;
+        c->written = 0;
+        c->responding = true;
+        sd_event_source_set_io_events(c->source, EPOLLOUT);
+    }
+
+    if (writeResponse(c))
+    {
+        c->owner->drop(c);
+    }
+    return 0;
+}
+
+int server::onTimeout(sd_event_source*, uint64_t, void* userdata)
+{
+    auto c = static_cast<connection*>(userdata);
+    c->owner->drop(c);
+    return 0;
+}
+
+void server::drop(connection* c)
+{
+    connections.erase(std::remove(connections.begin(), connections.end(), c),
+                      connections.end());
+    sd_event_source_unref(c->source);
+    sd_event_source_unref(c->timer);
+    close(c->fd);
+    delete c;
+    if (listener)
+    {
+        sd_event_source_set_enabled(listener, SD_EVENT_ON);
+    }
+}
+} // namespace metrics
+}
+}
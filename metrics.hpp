@@ -0,0 +1,115 @@
+#pragma once
+
+#include <systemd/sd-event.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+namespace metrics
+{
+/** @brief Prometheus histogram, counts aren't cumulative until rendered */
+struct histogram
+{
+    explicit histogram(std::vector<double> bounds) :
+        bounds(std::move(bounds)), counts(this->bounds.size() + 1)
+    {
+    }
+
+    void observe(double value);
+
+    /** @brief Upper bounds of the buckets, +Inf is implied */
+    std::vector<double> bounds;
+    std::vector<uint64_t> counts;
+    double sum = 0;
+    uint64_t count = 0;
+};
+
+/** @brief Append the HELP and TYPE lines of a metric family */
+void family(std::string& out, const std::string& name, const std::string& type,
+            const std::string& help);
+
+/** @brief Append one sample, labels as 'key="value",...' or empty */
+void sample(std::string& out, const std::string& name,
+            const std::string& labels, double value);
+
+/** @brief Append the bucket, sum and count samples of a histogram */
+void sample(std::string& out, const std::string& name,
+            const std::string& labels, const histogram& h);
+
+/** @class server
+ *  @brief Serves the metrics in Prometheus text format over HTTP on a
+ *         Unix socket.
+ *
+ *  Everything runs non-blocking on the event loop, at a lower priority
+ *  than polling. The metrics are rendered once per scrape, when the
+ *  request has arrived, and written out as the peer drains the socket.
+ *  A connection still open after a few seconds is dropped.
+ */
+class server
+{
+  public:
+    /** @brief Renders the metrics text */
+    using render = std::function<std::string()>;
+
+    server() = delete;
+    server(const server&) = delete;
+    server& operator=(const server&) = delete;
+    server(server&&) = delete;
+    server& operator=(server&&) = delete;
+    ~server();
+
+    /** @brief Listen on path, ready() tells if that failed
+     *
+     * @param[in] event - Event loop the socket is attached to
+     * @param[in] path  - Unix socket path, replaced if it exists
+     * @param[in] fn    - Called for each scrape
+     */
+    server(sd_event* event, const std::string& path, render fn);
+
+    bool ready() const
+    {
+        return listener != nullptr;
+    }
+
+  private:
+    struct connection
+    {
+        server* owner;
+        int fd;
+        sd_event_source* source;
+        /** @brief Drops the connection if it lasts too long */
+        sd_event_source* timer;
+        /** @brief Request read so far, then the response left to write */
+        std::string buffer;
+        size_t written;
+        bool responding;
+    };
+
+    static int onAccept(sd_event_source* source, int fd, uint32_t revents,
+                        void* userdata);
+    static int onConnection(sd_event_source* source, int fd, uint32_t revents,
+                            void* userdata);
+    static int onTimeout(sd_event_source* source, uint64_t usec,
+                         void* userdata);
+    /** @brief Read the request, true once it's complete */
+    static bool readRequest(connection* c);
+    /** @brief Write the response, true once it's all written */
+    static bool writeResponse(connection* c);
+    void drop(connection* c);
+
+    sd_event* event;
+    std::string path;
+    render fn;
+    int listenFd = -1;
+    sd_event_source* listener = nullptr;
+    std::vector<connection*> connections;
+};
+} // namespace metrics
+}
+}
@@ -0,0 +1,100 @@
+#include "config.h"
+#include "ratelimit.hpp"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <phosphor-logging/log.hpp>
+#include <tuple>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+namespace ratelimit
+{
+using namespace phosphor::logging;
+using clock = std::chrono::steady_clock;
+
+struct state
+{
+    /** @brief When the error was last logged */
+    clock::time_point logged;
+    /** @brief Repeats since then */
+    uint64_t suppressed;
+    int err;
+};
+
+static std::mutex mutex;
+static std::map<std::tuple<std::string, int, int>, state> errors;
+static const auto interval = std::chrono::seconds(LOG_RATELIMIT_INTERVAL_SECONDS);
+
+static void logError(const std::string& msg, int bus, int addr, int err)
+{
+    log<level::ERR>(msg.c_str(), entry("BUS=%d", bus),
+                    entry("ADDRESS=0x%02X", addr), entry("ERRNO=%d", err));
+}
+
+static void logSummary(const std::string& msg, int bus, int addr,
+                       const state& s)
+{
+    auto summary = msg + ": " + std::to_string(s.suppressed) +
+                   " repeats suppressed";
+    log<level::INFO>(summary.c_str(), entry("BUS=%d", bus),
+                     entry("ADDRESS=0x%02X", addr), entry("ERRNO=%d", s.err),
+                     entry("SUPPRESSED=%llu", (unsigned long long)s.suppressed));
+}
+
+void error(const std::string& msg, int bus, int addr, int err)
+{
+    auto now = clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto key = std::make_tuple(msg, bus, addr);
+    auto found = errors.find(key);
+    if (found != errors.end() && now - found->second.logged < interval)
+    {
+        found->second.suppressed++;
+        found->second.err = err;
+        return;
+    }
+
+    /* Still failing, only the summary goes out and a new interval starts */
+    if (found != errors.end() && found->second.suppressed > 0)
+    {
+        logSummary(msg, bus, addr, found->second);
+        found->second = {now, 1, err};
+        return;
+    }
+    logError(msg, bus, addr, err);
+    errors[key] = {now, 0, err};
+}
+
+void flush()
+{
+    auto now = clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto it = errors.begin(); it != errors.end();)
+    {
+        if (now - it->second.logged < interval)
+        {
+            it++;
+            continue;
+        }
+        if (it->second.suppressed > 0)
+        {
+            logSummary(std::get<0>(it->first), std::get<1>(it->first),
+                       std::get<2>(it->first), it->second);
+            it->second.logged = now;
+            it->second.suppressed = 0;
+            it++;
+            continue;
+        }
+        /* Quiet for a whole interval, next occurrence is logged again */
+        it = errors.erase(it);
+    }
+}
+} // namespace ratelimit
+}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+/** @brief Error logging for the polling path.
+ *
+ *  Errors go to the journal through phosphor-logging with BUS, ADDRESS
+ *  and ERRNO fields. The first occurrence of an error of a device is
+ *  logged, while it keeps repeating only a "N repeats suppressed" summary
+ *  goes out every LOG_RATELIMIT_INTERVAL_SECONDS. Once it stayed away for
+ *  a whole interval it's logged in full again.
+ */
+namespace ratelimit
+{
+/** @brief Log an error unless it's being suppressed
+ *
+ * @param[in] msg  - Message, also identifies the error
+ * @param[in] bus  - I2C bus of the device
+ * @param[in] addr - Address of the device
+ * @param[in] err  - errno of the failure, 0 if there's none
+ */
+void error(const std::string& msg, int bus, int addr, int err);
+
+/** @brief Log "N repeats suppressed" for the errors whose interval is
+ *         over, call once per poll cycle.
+ */
+void flush();
+} // namespace ratelimit
+}
+}
@@ -0,0 +1,52 @@
+#include "config.h"
+#include "readings.hpp"
+
+#include <iostream>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+const sdbusplus::vtable::vtable_t readings::vtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::method("GetAllReadings", "", "a(yxtbb)",
+                              readings::getAllReadings),
+    sdbusplus::vtable::end()};
+
+readings::readings(sdbusplus::bus::bus& bus, const char* objPath) :
+    iface(bus, objPath, BITTWARE_SOC_READINGS_IFACE, vtable, this)
+{
+}
+
+void readings::update(std::vector<cardReading>&& cards)
+{
+    snapshot.clear();
+    snapshot.reserve(cards.size());
+    for (const auto& card : cards)
+    {
+        snapshot.emplace_back(card.index, card.value, card.timestamp,
+                              card.present, card.functional);
+    }
+}
+
+int readings::getAllReadings(sd_bus_message* msg, void* context,
+                             sd_bus_error*)
+{
+    auto self = static_cast<readings*>(context);
+    try
+    {
+        auto m = sdbusplus::message::message(msg);
+        auto reply = m.new_method_return();
+        reply.append(self->snapshot);
+        reply.method_return();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "GetAllReadings fail. ERROR = " << e.what() << std::endl;
+        return -EIO;
+    }
+
+    return 1;
+}
+}
+}
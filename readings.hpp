@@ -0,0 +1,68 @@
+#pragma once
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/interface.hpp>
+#include <sdbusplus/vtable.hpp>
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+/** @brief Latest state of one card, as served by GetAllReadings */
+struct cardReading
+{
+    uint8_t index;
+    /** @brief Temperature, same unit and scale as Sensor.Value */
+    int64_t value;
+    /** @brief Microseconds since epoch of the last successful read */
+    uint64_t timestamp;
+    bool present;
+    /** @brief Whether the last read of the temperature succeeded */
+    bool functional;
+};
+
+/** @class readings
+ *  @brief Serves the readings of every card in one D-Bus reply.
+ *
+ *  GetAllReadings returns a(yxtbb): index, value, timestamp, present and
+ *  functional of each card, from the snapshot taken by the last poll
+ *  cycle, without touching the hardware.
+ */
+class readings
+{
+  public:
+    readings() = delete;
+    readings(const readings&) = delete;
+    readings& operator=(const readings&) = delete;
+    readings(readings&&) = delete;
+    readings& operator=(readings&&) = delete;
+    virtual ~readings() = default;
+
+    /** @brief Constructs readings
+     *
+     * @param[in] bus     - Handle to system dbus
+     * @param[in] objPath - The dbus path the interface is served on
+     */
+    readings(sdbusplus::bus::bus& bus, const char* objPath);
+
+    /** @brief Replace the snapshot, called once per poll cycle */
+    void update(std::vector<cardReading>&& cards);
+
+  private:
+    using readingTuple = std::tuple<uint8_t, int64_t, uint64_t, bool, bool>;
+
+    static int getAllReadings(sd_bus_message* msg, void* context,
+                              sd_bus_error* error);
+
+    static const sdbusplus::vtable::vtable_t vtable[];
+
+    /** @brief Snapshot in the wire format of GetAllReadings */
+    std::vector<readingTuple> snapshot;
+    sdbusplus::server::interface::interface iface;
+};
+}
+}
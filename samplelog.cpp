@@ -0,0 +1,301 @@
+#include "samplelog.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+namespace samplelog
+{
+static std::string segmentPath(const std::string& dir, uint64_t sequence)
+{
+    return dir + "/samples-" + std::to_string(sequence) + ".bwl";
+}
+
+/** @brief mkdir -p, /var/lib/bittware may not exist on a fresh install */
+static int makeDirs(const std::string& dir)
+{
+    for (auto pos = dir.find('/', 1); ; pos = dir.find('/', pos + 1))
+    {
+        auto part = dir.substr(0, pos);
+        if (mkdir(part.c_str(), 0755) < 0 && errno != EEXIST)
+        {
+            return -1;
+        }
+        if (pos == std::string::npos)
+        {
+            return 0;
+        }
+    }
+}
+
+/** @brief Sequence numbers of the segments in dir, ascending */
+static std::vector<uint64_t> listSegments(const std::string& dir)
+{
+    std::vector<uint64_t> sequences;
+    auto d = opendir(dir.c_str());
+    if (!d)
+    {
+        return sequences;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(d)) != nullptr)
+    {
+        unsigned long long seq;
+        char suffix[8];
+        if (sscanf(entry->d_name, "samples-%llu.%7s", &seq, suffix) == 2 &&
+            strcmp(suffix, "bwl") == 0)
+        {
+            sequences.push_back(seq);
+        }
+    }
+    closedir(d);
+    std::sort(sequences.begin(), sequences.end());
+
+    return sequences;
+}
+
+writer::writer(const std::string& dir, uint64_t maxSize, uint32_t segments) :
+    dir(dir), segments(std::max<uint32_t>(segments, 2))
+{
+    auto segmentSize = maxSize / this->segments;
+    if (segmentSize < sizeof(header) + sizeof(record))
+    {
+        std::cerr << "Sample log budget too small" << std::endl;
+        return;
+    }
+    segmentRecords = (segmentSize - sizeof(header)) / sizeof(record);
+
+    if (makeDirs(dir) < 0)
+    {
+        std::cerr << "Failed to create " << dir << ": " << strerror(errno)
+                  << std::endl;
+        return;
+    }
+
+    /* Carry on with the last segment of a previous run */
+    auto existing = listSegments(dir);
+    if (!existing.empty())
+    {
+        sequence = existing.back();
+        auto path = segmentPath(dir, sequence);
+        /* Read too, for the timestamp of its last record */
+        fd = open(path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 &&
+            static_cast<uint64_t>(st.st_size) >= sizeof(header) &&
+            (st.st_size - sizeof(header)) % sizeof(record) == 0)
+        {
+            records = (st.st_size - sizeof(header)) / sizeof(record);
+            record last;
+            if (records > 0 &&
+                pread(fd, &last, sizeof(last),
+                      st.st_size - sizeof(last)) == sizeof(last))
+            {
+                lastTimestamp = last.timestamp;
+            }
+            return;
+        }
+        /* Torn by a crash, start over in a new segment */
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    rotate();
+}
+
+writer::~writer()
+{
+    flush();
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+bool writer::rotate()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    sequence++;
+    auto path = segmentPath(dir, sequence);
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+              0644);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to create " << path << ": " << strerror(errno)
+                  << std::endl;
+        return false;
+    }
+    records = 0;
+
+    header hdr{magic, version, sizeof(record), sequence};
+    if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+    {
+        std::cerr << "Failed to write " << path << std::endl;
+    }
+
+    for (auto seq : listSegments(dir))
+    {
+        if (seq + segments <= sequence)
+        {
+            unlink(segmentPath(dir, seq).c_str());
+        }
+    }
+    return true;
+}
+
+void writer::add(uint64_t timestamp, uint8_t index, int64_t value,
+                 bool present, bool functional)
+{
+    /* Keep each segment sorted for the readers' bisection */
+    if (timestamp < lastTimestamp)
+    {
+        flush();
+        if (fd >= 0 && records > 0)
+        {
+            rotate();
+        }
+    }
+    lastTimestamp = timestamp;
+
+    record r{};
+    r.timestamp = timestamp;
+    r.value = static_cast<int32_t>(value);
+    r.index = index;
+    r.flags = (present ? presentFlag : 0) | (functional ? functionalFlag : 0);
+    buffer.push_back(r);
+    if (buffer.size() >= maxPending)
+    {
+        flush();
+    }
+}
+
+void writer::flush()
+{
+    size_t done = 0;
+    while (fd >= 0 && done < buffer.size())
+    {
+        if (records >= segmentRecords && !rotate())
+        {
+            break;
+        }
+        auto count = std::min<uint64_t>(buffer.size() - done,
+                                        segmentRecords - records);
+        auto len = count * sizeof(record);
+        if (write(fd, buffer.data() + done, len) != static_cast<ssize_t>(len))
+        {
+            std::cerr << "Failed to append to the sample log" << std::endl;
+            break;
+        }
+        records += count;
+        done += count;
+    }
+    buffer.clear();
+}
+
+/** @brief Index of the first record of the segment at or after t */
+static uint64_t seek(int fd, uint64_t count, uint64_t t)
+{
+    uint64_t lo = 0, hi = count;
+    while (lo < hi)
+    {
+        auto mid = lo + (hi - lo) / 2;
+        record r;
+        if (pread(fd, &r, sizeof(r), sizeof(header) + mid * sizeof(r)) !=
+            sizeof(r))
+        {
+            return count;
+        }
+        if (r.timestamp < t)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+std::vector<record> read(const std::string& dir, uint64_t from, uint64_t to)
+{
+    std::vector<record> samples;
+
+    for (auto seq : listSegments(dir))
+    {
+        int fd = open(segmentPath(dir, seq).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        header hdr;
+        struct stat st;
+        if (pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+            hdr.magic != magic || hdr.version != version ||
+            hdr.recordSize != sizeof(record) || fstat(fd, &st) < 0)
+        {
+            close(fd);
+            continue;
+        }
+
+        uint64_t count = (st.st_size - sizeof(hdr)) / sizeof(record);
+        record last;
+        /* Skip segments ending before the window without bisecting */
+        if (count == 0 ||
+            pread(fd, &last, sizeof(last),
+                  sizeof(hdr) + (count - 1) * sizeof(last)) != sizeof(last) ||
+            last.timestamp < from)
+        {
+            close(fd);
+            continue;
+        }
+
+        record batch[256];
+        bool past = false;
+        /* A later segment may follow a clock step back, read it too */
+        for (auto i = seek(fd, count, from); i < count && !past;)
+        {
+            auto n = std::min<uint64_t>(count - i, 256);
+            auto len = pread(fd, batch, n * sizeof(record),
+                             sizeof(hdr) + i * sizeof(record));
+            if (len <= 0)
+            {
+                break;
+            }
+            n = len / sizeof(record);
+            for (uint64_t j = 0; j < n; j++)
+            {
+                if (batch[j].timestamp > to)
+                {
+                    past = true;
+                    break;
+                }
+                samples.push_back(batch[j]);
+            }
+            i += n;
+        }
+        close(fd);
+    }
+
+    return samples;
+}
+} // namespace samplelog
+}
+}
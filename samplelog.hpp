@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+/** @brief Append-only log of the card samples, in fixed width records.
+ *
+ *  The log is a set of segment files samples-<sequence>.bwl in a
+ *  directory. Samples are kept in RAM and appended in batches, when the
+ *  current segment is full the next one is started and the oldest is
+ *  removed so the log stays within its size budget. Timestamps come from
+ *  the wall clock, which may step back: a sample older than the one
+ *  before starts a new segment, so the records of each segment are in
+ *  time order and readers find a time window by bisecting each segment.
+ */
+namespace samplelog
+{
+constexpr uint32_t magic = 0x4c535742; /* "BWSL" */
+constexpr uint16_t version = 1;
+
+/** @brief Fixed binary layout of a segment header, little endian */
+struct header
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    /** @brief Sequence number of the segment, also in its file name */
+    uint64_t sequence;
+};
+static_assert(sizeof(header) == 16, "sample log header layout changed");
+
+/** @brief Fixed binary layout of a sample */
+struct record
+{
+    /** @brief Microseconds since epoch of the poll cycle */
+    uint64_t timestamp;
+    /** @brief Temperature, same unit and scale as Sensor.Value */
+    int32_t value;
+    uint8_t index;
+    /** @brief present and functional bits */
+    uint8_t flags;
+    uint16_t reserved;
+};
+static_assert(sizeof(record) == 16, "sample log record layout changed");
+
+constexpr uint8_t presentFlag = 1 << 0;
+constexpr uint8_t functionalFlag = 1 << 1;
+
+/** @class writer
+ *  @brief Buffers samples and appends them to the log in batches.
+ */
+class writer
+{
+  public:
+    writer(const writer&) = delete;
+    writer& operator=(const writer&) = delete;
+    /** @brief Flushes the samples still buffered */
+    ~writer();
+
+    /** @brief Open the log, ready() tells if that failed
+     *
+     * @param[in] dir      - Directory of the segments, created if missing
+     * @param[in] maxSize  - Size budget in bytes of all segments
+     * @param[in] segments - Number of segments the budget is split into
+     */
+    writer(const std::string& dir, uint64_t maxSize, uint32_t segments);
+
+    bool ready() const
+    {
+        return fd >= 0;
+    }
+
+    /** @brief Buffer a sample, flushes once maxPending are buffered
+     *
+     * @param[in] timestamp - Microseconds since epoch of the poll cycle
+     * @param[in] value     - Temperature, same unit and scale as
+     *                        Sensor.Value
+     */
+    void add(uint64_t timestamp, uint8_t index, int64_t value, bool present,
+             bool functional);
+
+    /** @brief Append the buffered samples to the log */
+    void flush();
+
+    /** @brief Number of samples buffered */
+    size_t pending() const
+    {
+        return buffer.size();
+    }
+
+  private:
+    /** @brief Start the segment of the next sequence number */
+    bool rotate();
+
+    std::string dir;
+    /** @brief Records per segment */
+    uint64_t segmentRecords;
+    uint32_t segments;
+    uint64_t sequence = 0;
+    /** @brief Records in the current segment */
+    uint64_t records = 0;
+    /** @brief Timestamp of the last sample, buffered or written */
+    uint64_t lastTimestamp = 0;
+    int fd = -1;
+    std::vector<record> buffer;
+    /** @brief Bound of the RAM used between flushes */
+    static constexpr size_t maxPending = 4096;
+};
+
+/** @brief Read the samples of a time window, seeking to it in each
+ *         segment instead of scanning.
+ *
+ * @param[in] dir  - Directory of the segments
+ * @param[in] from - First microsecond since epoch of the window
+ * @param[in] to   - Last microsecond since epoch of the window
+ *
+ * @return Samples of the window in the order they were logged, oldest
+ *         first unless the clock stepped back within the window
+ */
+std::vector<record> read(const std::string& dir, uint64_t from, uint64_t to);
+} // namespace samplelog
+}
+}
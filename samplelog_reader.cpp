@@ -0,0 +1,45 @@
+#include "samplelog.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+/* Decode the samples of a time window of the Bittware sample log.
+ *
+ *   bittware-samplelog <dir> [<from> [<to>]]
+ *
+ * from and to are seconds since epoch, the whole log by default.
+ */
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 4)
+    {
+        fprintf(stderr, "Usage: %s <dir> [<from> [<to>]]\n", argv[0]);
+        return 1;
+    }
+
+    uint64_t from = 0;
+    uint64_t to = std::numeric_limits<uint64_t>::max();
+    if (argc > 2)
+    {
+        from = strtoull(argv[2], nullptr, 10) * 1000000;
+    }
+    if (argc > 3)
+    {
+        to = strtoull(argv[3], nullptr, 10) * 1000000 + 999999;
+    }
+
+    namespace samplelog = phosphor::mpSOC::samplelog;
+    for (const auto& r : samplelog::read(argv[1], from, to))
+    {
+        /* Sensor.Value of the cards has scale -4 */
+        printf("%llu.%06llu %u %.4f%s%s\n",
+               (unsigned long long)(r.timestamp / 1000000),
+               (unsigned long long)(r.timestamp % 1000000), r.index,
+               r.value * 1e-4,
+               (r.flags & samplelog::presentFlag) ? "" : " absent",
+               (r.flags & samplelog::functionalFlag) ? "" : " failed");
+    }
+
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+/* Wake up within a millisecond of the deadline, sd-event defaults to 250ms */
+#define SCHEDULER_ACCURACY_USEC 1000
+/* Highest urgency shortening the interval, each level halves it */
+#define SCHEDULER_MAX_URGENCY_SHIFT 2
+
+namespace phosphor
+{
+namespace mpSOC
+{
+static uint64_t toUsec(scheduler::clock::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               t.time_since_epoch())
+        .count();
+}
+
+scheduler::scheduler(sd_event* event, callback fire) :
+    event(event), fire(std::move(fire))
+{
+    auto res = sd_event_add_time(event, &timer, CLOCK_MONOTONIC, 0,
+                                 SCHEDULER_ACCURACY_USEC, &scheduler::onTimer,
+                                 this);
+    if (res < 0)
+    {
+        std::cerr << "Failed to add scheduler timer: " << strerror(-res)
+                  << std::endl;
+        timer = nullptr;
+        return;
+    }
+    sd_event_source_set_enabled(timer, SD_EVENT_OFF);
+    /* Polling goes ahead of bring-up work and reloads ready at the same time */
+    sd_event_source_set_priority(timer, SD_EVENT_PRIORITY_IMPORTANT);
+}
+
+scheduler::~scheduler()
+{
+    if (timer)
+    {
+        sd_event_source_unref(timer);
+    }
+}
+
+void scheduler::schedule(uint8_t id, std::chrono::milliseconds interval,
+                         uint8_t priority)
+{
+    auto& s = slots[id];
+    auto now = clock::now();
+    auto deadline = now;
+
+    if (s.active)
+    {
+        deadline = std::min(s.deadline, now + interval);
+    }
+    s.active = true;
+    s.generation++;
+    s.interval = interval;
+    s.deadline = deadline;
+    s.priority = priority;
+    push(id);
+    arm();
+}
+
+void scheduler::setUrgency(uint8_t id, uint8_t urgency)
+{
+    auto& s = slots[id];
+    auto raised = urgency > s.urgency;
+    s.urgency = urgency;
+    if (!s.active || !raised)
+    {
+        return;
+    }
+
+    /* Don't wait out the rest of the normal interval */
+    auto deadline = clock::now() + period(s);
+    if (deadline < s.deadline)
+    {
+        s.generation++;
+        s.deadline = deadline;
+        push(id);
+        arm();
+    }
+}
+
+scheduler::clock::duration scheduler::period(const slot& s)
+{
+    auto shift = std::min<uint8_t>(s.urgency, SCHEDULER_MAX_URGENCY_SHIFT);
+    return std::max<clock::duration>(s.interval / (1 << shift),
+                                     std::chrono::milliseconds(1));
+}
+
+void scheduler::unschedule(uint8_t id)
+{
+    auto& s = slots[id];
+    s.active = false;
+    s.generation++;
+    s.urgency = 0;
+    arm();
+}
+
+void scheduler::push(uint8_t id)
+{
+    heap.push_back({slots[id].deadline, id, slots[id].generation});
+    std::push_heap(heap.begin(), heap.end(), later);
+}
+
+void scheduler::arm()
+{
+    while (!heap.empty())
+    {
+        const auto& top = heap.front();
+        const auto& s = slots[top.id];
+        if (s.active && s.generation == top.generation)
+        {
+            break;
+        }
+        std::pop_heap(heap.begin(), heap.end(), later);
+        heap.pop_back();
+    }
+
+    if (!timer)
+    {
+        return;
+    }
+    if (heap.empty())
+    {
+        sd_event_source_set_enabled(timer, SD_EVENT_OFF);
+        return;
+    }
+    sd_event_source_set_time(timer, toUsec(heap.front().deadline));
+    sd_event_source_set_enabled(timer, SD_EVENT_ONESHOT);
+}
+
+void scheduler::fireDue()
+{
+    auto now = clock::now();
+    std::vector<entry> due;
+
+    while (!heap.empty() && heap.front().deadline <= now)
+    {
+        auto e = heap.front();
+        std::pop_heap(heap.begin(), heap.end(), later);
+        heap.pop_back();
+
+        auto& s = slots[e.id];
+        if (!s.active || s.generation != e.generation)
+        {
+            continue;
+        }
+        due.push_back(e);
+
+        /* Stay on the original grid, skipping periods that were missed */
+        auto step = period(s);
+        auto next = s.deadline + step;
+        if (next <= now)
+        {
+            next += ((now - next) / step + 1) * step;
+        }
+        s.deadline = next;
+        push(e.id);
+    }
+
+    if (!due.empty())
+    {
+        std::stable_sort(due.begin(), due.end(),
+                         [this](const entry& a, const entry& b) {
+                             const auto& sa = slots[a.id];
+                             const auto& sb = slots[b.id];
+                             if (sa.urgency != sb.urgency)
+                             {
+                                 return sa.urgency > sb.urgency;
+                             }
+                             if (sa.priority != sb.priority)
+                             {
+                                 return sa.priority > sb.priority;
+                             }
+                             if (sa.group != sb.group)
+                             {
+                                 return sa.group < sb.group;
+                             }
+                             return a.deadline < b.deadline;
+                         });
+        std::vector<uint8_t> ids;
+        ids.reserve(due.size());
+        for (const auto& e : due)
+        {
+            ids.push_back(e.id);
+        }
+        fire(ids);
+    }
+    arm();
+}
+
+int scheduler::onTimer(sd_event_source*, uint64_t, void* userdata)
+{
+    static_cast<scheduler*>(userdata)->fireDue();
+    return 0;
+}
+}
+}
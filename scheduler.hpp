@@ -0,0 +1,124 @@
+#pragma once
+
+#include <systemd/sd-event.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+/** @class scheduler
+ *  @brief Per-card poll deadlines driven by a single sd-event timer.
+ *
+ *  Deadlines are absolute CLOCK_MONOTONIC time points kept in a min-heap,
+ *  the next one is always deadline + interval so periods don't drift with
+ *  the time spent reading. The timer is armed for the earliest deadline
+ *  and only the cards that are due are handed to the callback.
+ *
+ *  A card near its thermal limits is polled at its interval halved per
+ *  urgency level, its pending deadline is brought forward as soon as its
+ *  urgency rises. Cards due together are read with cards near their
+ *  thermal limits ahead of all others, so their latency stays bounded
+ *  when the bus is congested and reads run late, then by priority. Within a level cards are grouped
+ *  by their mux channel, they're all due already and switching channels
+ *  costs a transaction each time, and read earliest deadline first.
+ */
+class scheduler
+{
+  public:
+    using clock = std::chrono::steady_clock;
+    /** @brief Receives the ids of the due cards in the order to read them */
+    using callback = std::function<void(const std::vector<uint8_t>& due)>;
+
+    scheduler() = delete;
+    scheduler(const scheduler&) = delete;
+    scheduler& operator=(const scheduler&) = delete;
+    scheduler(scheduler&&) = delete;
+    scheduler& operator=(scheduler&&) = delete;
+    ~scheduler();
+
+    /** @brief Constructs scheduler
+     *
+     * @param[in] event - Event loop the timer is attached to
+     * @param[in] fire  - Called with the due cards
+     */
+    scheduler(sd_event* event, callback fire);
+
+    /** @brief Poll a card every interval, it's due right away when it
+     *         wasn't scheduled yet. Rescheduling keeps the pending deadline
+     *         unless the new interval makes it due earlier.
+     */
+    void schedule(uint8_t id, std::chrono::milliseconds interval,
+                  uint8_t priority);
+
+    /** @brief Set how close a card is to its limits, higher is read first
+     *         and more often. A rise brings the pending deadline forward.
+     */
+    void setUrgency(uint8_t id, uint8_t urgency);
+
+    /** @brief Set the group of a card, cards due together are read in
+     *         ascending group order within an urgency and priority level.
+     */
+    void setGroup(uint8_t id, uint32_t group)
+    {
+        slots[id].group = group;
+    }
+
+    /** @brief Stop polling a card */
+    void unschedule(uint8_t id);
+
+    /** @brief Deadline the card is currently scheduled for */
+    clock::time_point deadline(uint8_t id) const
+    {
+        return slots[id].deadline;
+    }
+
+  private:
+    struct entry
+    {
+        clock::time_point deadline;
+        uint8_t id;
+        /** @brief Entries of an older generation of the slot are stale */
+        uint32_t generation;
+    };
+
+    struct slot
+    {
+        bool active = false;
+        uint32_t generation = 0;
+        uint8_t priority = 0;
+        uint8_t urgency = 0;
+        uint32_t group = 0;
+        clock::duration interval;
+        clock::time_point deadline;
+    };
+
+    static int onTimer(sd_event_source* source, uint64_t usec,
+                       void* userdata);
+
+    static bool later(const entry& a, const entry& b)
+    {
+        return a.deadline > b.deadline;
+    }
+
+    /** @brief Interval of a card shortened by its urgency */
+    static clock::duration period(const slot& s);
+
+    void push(uint8_t id);
+    /** @brief Drop stale entries and arm the timer for the earliest one */
+    void arm();
+    void fireDue();
+
+    sd_event* event;
+    sd_event_source* timer = nullptr;
+    callback fire;
+    std::array<slot, 256> slots;
+    std::vector<entry> heap;
+};
+}
+}
@@ -1,10 +1,19 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <list>
+#include <memory>
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/elog.hpp>
 #include <phosphor-logging/log.hpp>
 #include <sdbusplus/bus.hpp>
 #include <sdbusplus/bus/match.hpp>
 #include <sdbusplus/message.hpp>
+#include <systemd/sd-bus.h>
 #include <xyz/openbmc_project/Common/error.hpp>
 
 namespace phosphor
@@ -14,6 +23,154 @@ namespace mpSOC
 namespace util
 {
 
+/** @class AsyncCallQueue
+ *  @brief Issue D-Bus method calls without blocking the caller.
+ *
+ *  Calls are sent with sd_bus_call_async and completed from the sd-event
+ *  loop the bus is attached to. At most maxInFlight calls are outstanding
+ *  at any time, further calls wait in FIFO order.
+ */
+class AsyncCallQueue
+{
+  public:
+    /** @brief Completion callback
+     *
+     *  @param[in] success - False on error reply, timeout or send failure
+     *  @param[in] reply   - Method reply, only readable when success is true
+     */
+    using Callback =
+        std::function<void(bool success, sdbusplus::message::message& reply)>;
+
+    AsyncCallQueue() = delete;
+    AsyncCallQueue(const AsyncCallQueue&) = delete;
+    AsyncCallQueue& operator=(const AsyncCallQueue&) = delete;
+    AsyncCallQueue(AsyncCallQueue&&) = delete;
+    AsyncCallQueue& operator=(AsyncCallQueue&&) = delete;
+
+    /** @brief Constructs AsyncCallQueue
+     *
+     * @param[in] bus         - Handle to system dbus
+     * @param[in] timeout     - Per call timeout in microseconds
+     * @param[in] maxInFlight - Maximum number of outstanding calls
+     */
+    AsyncCallQueue(sdbusplus::bus::bus& bus,
+                   uint64_t timeout = DBUS_ASYNC_TIMEOUT_USEC,
+                   size_t maxInFlight = DBUS_ASYNC_MAX_INFLIGHT) :
+        bus(bus),
+        timeout(timeout), maxInFlight(std::max<size_t>(maxInFlight, 1))
+    {
+    }
+
+    ~AsyncCallQueue()
+    {
+        for (auto& c : inFlight)
+        {
+            sd_bus_slot_unref(c->slot);
+        }
+    }
+
+    sdbusplus::bus::bus& getBus()
+    {
+        return bus;
+    }
+
+    /** @brief Queue a method call, it's sent as soon as a slot is free */
+    void call(sdbusplus::message::message& msg, Callback callback = nullptr)
+    {
+        pending.emplace_back(
+            std::make_unique<asyncCall>(this, msg, std::move(callback)));
+        dispatch();
+    }
+
+    /** @brief Number of calls sent and still waiting for a reply */
+    size_t outstanding() const
+    {
+        return inFlight.size();
+    }
+
+  private:
+    struct asyncCall
+    {
+        asyncCall(AsyncCallQueue* queue, sdbusplus::message::message& msg,
+                  Callback&& callback) :
+            queue(queue),
+            msg(msg), callback(std::move(callback)), slot(nullptr)
+        {
+        }
+        AsyncCallQueue* queue;
+        sdbusplus::message::message msg;
+        Callback callback;
+        sd_bus_slot* slot;
+    };
+
+    static int handler(sd_bus_message* m, void* userdata, sd_bus_error*)
+    {
+        auto c = static_cast<asyncCall*>(userdata);
+        c->queue->complete(c, m);
+        return 0;
+    }
+
+    void dispatch()
+    {
+        while (!pending.empty() && inFlight.size() < maxInFlight)
+        {
+            auto c = std::move(pending.front());
+            pending.pop_front();
+
+            auto res = sd_bus_call_async(bus.get(), &c->slot, c->msg.get(),
+                                         &AsyncCallQueue::handler, c.get(),
+                                         timeout);
+            if (res < 0)
+            {
+                std::cerr << "Async call fail. ERROR = " << strerror(-res)
+                          << std::endl;
+                if (c->callback)
+                {
+                    c->callback(false, c->msg);
+                }
+                continue;
+            }
+            inFlight.push_back(std::move(c));
+        }
+    }
+
+    void complete(asyncCall* c, sd_bus_message* m)
+    {
+        auto it = std::find_if(
+            inFlight.begin(), inFlight.end(),
+            [c](const std::unique_ptr<asyncCall>& p) { return p.get() == c; });
+        if (it == inFlight.end())
+        {
+            return;
+        }
+        auto done = std::move(*it);
+        inFlight.erase(it);
+
+        sdbusplus::message::message reply(m);
+        bool success = !sd_bus_message_is_method_error(m, nullptr);
+        if (!success)
+        {
+            auto error = sd_bus_message_get_error(m);
+            std::cerr << "Async call fail. ERROR = "
+                      << ((error && error->message) ? error->message : "")
+                      << std::endl;
+        }
+        if (done->callback)
+        {
+            done->callback(success, reply);
+        }
+        sd_bus_slot_unref(done->slot);
+
+        dispatch();
+    }
+
+    sdbusplus::bus::bus& bus;
+    uint64_t timeout;
+    size_t maxInFlight;
+    std::deque<std::unique_ptr<asyncCall>> pending;
+    std::list<std::unique_ptr<asyncCall>> inFlight;
+};
+
 class SDBusPlus
 {
   public:
@@ -95,6 +252,105 @@ class SDBusPlus
             return;
         }
     }
+
+    template <typename T>
+    static void setPropertyAsync(AsyncCallQueue& queue,
+                                 const std::string& busName,
+                                 const std::string& objPath,
+                                 const std::string& interface,
+                                 const std::string& property, const T& value,
+                                 AsyncCallQueue::Callback callback = nullptr)
+    {
+        sdbusplus::message::variant<T> data = value;
+
+        try
+        {
+            auto methodCall = queue.getBus().new_method_call(
+                busName.c_str(), objPath.c_str(), DBUS_PROPERTY_IFACE, "Set");
+
+            methodCall.append(interface.c_str());
+            methodCall.append(property);
+            methodCall.append(data);
+
+            queue.call(methodCall, std::move(callback));
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Set properties fail. ERROR = " << e.what()
+                      << std::endl;
+            std::cerr << "Object path = " << objPath << std::endl;
+        }
+    }
+
+    template <typename Property>
+    static void getPropertyAsync(
+        AsyncCallQueue& queue, const std::string& busName,
+        const std::string& objPath, const std::string& interface,
+        const std::string& property,
+        std::function<void(bool success, const Property& value)> callback)
+    {
+        try
+        {
+            auto methodCall = queue.getBus().new_method_call(
+                busName.c_str(), objPath.c_str(), DBUS_PROPERTY_IFACE, "Get");
+
+            methodCall.append(interface.c_str());
+            methodCall.append(property);
+
+            queue.call(methodCall, [callback, objPath](
+                                       bool success,
+                                       sdbusplus::message::message& reply) {
+                sdbusplus::message::variant<Property> value;
+                if (success)
+                {
+                    try
+                    {
+                        reply.read(value);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        std::cerr << "Get properties fail.. ERROR = "
+                                  << e.what() << std::endl;
+                        std::cerr << "Object path = " << objPath << std::endl;
+                        success = false;
+                    }
+                }
+                callback(success,
+                         sdbusplus::message::variant_ns::get<Property>(value));
+            });
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Get properties fail.. ERROR = " << e.what()
+                      << std::endl;
+            std::cerr << "Object path = " << objPath << std::endl;
+        }
+    }
+
+    template <typename... Args>
+    static void CallMethodAsync(AsyncCallQueue& queue,
+                                const std::string& busName,
+                                const std::string& objPath,
+                                const std::string& interface,
+                                const std::string& method,
+                                AsyncCallQueue::Callback callback,
+                                Args&&... args)
+    {
+        try
+        {
+            auto reqMsg = queue.getBus().new_method_call(
+                busName.c_str(), objPath.c_str(), interface.c_str(),
+                method.c_str());
+            reqMsg.append(std::forward<Args>(args)...);
+
+            queue.call(reqMsg, std::move(callback));
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Call method fail. ERROR = " << e.what() << std::endl;
+            std::cerr << "Object path = " << objPath << std::endl;
+        }
+    }
 };
 }
 }
@@ -1,6 +1,10 @@
+#include "ratelimit.hpp"
 #include "smbus.hpp"
 #include "sensor.hpp"
 
+#include <unistd.h>
+
+#include <cstdlib>
 #include <iostream>
 
 #define TMP431_LOCAL_HIGH_COMMAND 0x00
@@ -9,16 +13,48 @@
 #define TMP431_LOCAL_LOW_STEP 625
 #define TMP431_TEMPERATURE_MULTIPLIER 10000
 #define TMP431_TEMPERATURE_SCALE -4
+/* hwmon reports millidegrees C */
+#define HWMON_TEMPERATURE_MULTIPLIER 10
 
 namespace phosphor
 {
 namespace mpSOC
 {
-sensor::sensor(sdbusplus::bus::bus& bus, std::string path, uint8_t busID) :
-    busID(busID),
-    bittwareIfaces(bus, path.c_str())
+sensor::sensor(sdbusplus::bus::bus& bus, std::string path, uint8_t busID,
+               const backendConfig& backend) :
+    busID(busID), sysfsRoot(backend.sysfsRoot),
+    alarmLimits(backend.alarmLimits),
+    bittwareIfaces(bus, path.c_str(), true)
+{
+    /* Signals are deferred until emit_object_added(), initial properties
+     * go out with the single InterfacesAdded.
+     */
+    valueIface::scale(TMP431_TEMPERATURE_SCALE, true);
+
+    if (backend.mode != backendConfig::type::i2cdev)
+    {
+        hwmonFd = hwmon::openAttribute(backend.sysfsRoot, busID,
+                                       TMP431_SLAVE_ADDR, "temp1_input");
+        hwmonOnly = (backend.mode == backendConfig::type::hwmon);
+        if (hwmonFd < 0 && hwmonOnly)
+        {
+            std::cerr << "tmp401 not bound on bus " << (int)busID
+                      << std::endl;
+        }
+    }
+}
+
+sensor::~sensor()
 {
-    valueIface::scale(TMP431_TEMPERATURE_SCALE);
+    for (auto& a : alarms)
+    {
+        a.source.reset();
+        close(a.fd);
+    }
+    if (hwmonFd >= 0)
+    {
+        close(hwmonFd);
+    }
 }
 
 static inline temperature caculate(uint8_t high, uint8_t low)
@@ -27,18 +63,109 @@ static inline temperature caculate(uint8_t high, uint8_t low)
         ((low >> 4) * TMP431_LOCAL_LOW_STEP), TMP431_TEMPERATURE_SCALE};
 }
 
-void sensor::setSensorThreshold(uint64_t criticalHigh, uint64_t criticalLow,
-                                 uint64_t maxValue, uint64_t minValue,
-                                 uint64_t warningHigh, uint64_t warningLow)
+void sensor::setSensorThreshold(int64_t criticalHigh, int64_t criticalLow,
+                                 int64_t maxValue, int64_t minValue,
+                                 int64_t warningHigh, int64_t warningLow,
+                                 bool skipSignal)
+{
+    criticalInterface::criticalHigh(criticalHigh * TMP431_TEMPERATURE_MULTIPLIER, skipSignal);
+    criticalInterface::criticalLow(criticalLow * TMP431_TEMPERATURE_MULTIPLIER, skipSignal);
+
+    warningInterface::warningHigh(warningHigh * TMP431_TEMPERATURE_MULTIPLIER, skipSignal);
+    warningInterface::warningLow(warningLow * TMP431_TEMPERATURE_MULTIPLIER, skipSignal);
+
+    valueIface::maxValue(maxValue * TMP431_TEMPERATURE_MULTIPLIER, skipSignal);
+    valueIface::minValue(minValue * TMP431_TEMPERATURE_MULTIPLIER, skipSignal);
+
+    /* The max alarm may raise at the D-Bus warning level. The crit limit
+     * drives THERM, a hardware failsafe, and is never lowered from here.
+     * A warningHigh of 0 isn't configured.
+     */
+    if (hwmonFd >= 0 && alarmLimits && warningHigh != 0 &&
+        warningHigh != maxLimit && setLimit("temp1_max", warningHigh))
+    {
+        maxLimit = warningHigh;
+    }
+}
+
+bool sensor::setLimit(const std::string& attr, int64_t degrees)
+{
+    bool success = true;
+    auto fd = hwmon::openAttribute(sysfsRoot, busID, TMP431_SLAVE_ADDR, attr,
+                                   true);
+    if (fd < 0 || hwmon::writeAttribute(fd, degrees * 1000) < 0)
+    {
+        std::cerr << "Failed to set " << attr << " on bus " << (int)busID
+                  << std::endl;
+        success = false;
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return success;
+}
+
+bool sensor::watchAlarms(const sdeventplus::Event& event,
+                         std::function<void()> onAlarm)
+{
+    if (hwmonFd < 0)
+    {
+        return false;
+    }
+
+    for (auto attr : {"temp1_max_alarm", "temp1_crit_alarm"})
+    {
+        auto fd = hwmon::openAttribute(sysfsRoot, busID, TMP431_SLAVE_ADDR,
+                                       attr);
+        if (fd < 0)
+        {
+            continue;
+        }
+        /* sysfs_notify() shows as EPOLLPRI, reading the attribute rearms */
+        int64_t state;
+        hwmon::readAttribute(fd, state);
+        auto source = std::make_unique<sdeventplus::source::IO>(
+            event, fd, EPOLLPRI,
+            [onAlarm](sdeventplus::source::IO&, int fd, uint32_t) {
+                int64_t state;
+                hwmon::readAttribute(fd, state);
+                onAlarm();
+            });
+        alarms.push_back({fd, std::move(source)});
+    }
+
+    return !alarms.empty();
+}
+
+void sensor::setDeadband(double deadband)
 {
-    criticalInterface::criticalHigh(criticalHigh * TMP431_TEMPERATURE_MULTIPLIER);
-    criticalInterface::criticalLow(criticalLow * TMP431_TEMPERATURE_MULTIPLIER);
+    this->deadband = std::llabs(
+        static_cast<int64_t>(deadband * TMP431_TEMPERATURE_MULTIPLIER));
+}
 
-    warningInterface::warningHigh(warningHigh * TMP431_TEMPERATURE_MULTIPLIER);
-    warningInterface::warningLow(warningLow * TMP431_TEMPERATURE_MULTIPLIER);
+uint8_t sensor::urgency(double margin) const
+{
+    /* Value lags the reading by up to the deadband */
+    auto value = reading;
+    auto offset = static_cast<int64_t>(margin * TMP431_TEMPERATURE_MULTIPLIER);
+    auto critical = criticalInterface::criticalHigh();
+    auto warning = warningInterface::warningHigh();
 
-    valueIface::maxValue(maxValue * TMP431_TEMPERATURE_MULTIPLIER);
-    valueIface::minValue(minValue * TMP431_TEMPERATURE_MULTIPLIER);
+    if (!valueSet)
+    {
+        return 0;
+    }
+    /* A threshold left at 0 isn't configured */
+    if (critical != 0 && value >= critical - offset)
+    {
+        return 2;
+    }
+    if (warning != 0 && value >= warning - offset)
+    {
+        return 1;
+    }
+    return 0;
 }
 
 void sensor::setSensorValueToDbus(const u_int64_t value)
@@ -46,30 +173,94 @@ void sensor::setSensorValueToDbus(const u_int64_t value)
     valueIface::value(value);
 }
 
-void sensor::getTemp()
+void sensor::restore(int64_t value)
+{
+    valueIface::value(value, true);
+    reading = value;
+    valueSet = true;
+}
+
+void sensor::update(int64_t value)
+{
+    reading = value;
+    if (!valueSet || std::llabs(value - valueIface::value()) >= deadband)
+    {
+        setSensorValueToDbus(value);
+        valueSet = true;
+    }
+}
+
+bool sensor::getTemp(bool urgent)
+{
+    int64_t value;
+
+    if (hwmonFd >= 0)
+    {
+        auto res = hwmon::readAttribute(hwmonFd, value);
+        if (res < 0)
+        {
+            ratelimit::error("Failed to read temp1_input", busID,
+                             TMP431_SLAVE_ADDR, -res);
+            return false;
+        }
+        update(value * HWMON_TEMPERATURE_MULTIPLIER);
+        return true;
+    }
+    if (hwmonOnly || !readI2C(value, urgent))
+    {
+        return false;
+    }
+    update(value);
+    return true;
+}
+
+bool sensor::readI2C(int64_t& value, bool urgent)
 {
+    bool success = false;
     auto bus = phosphor::smbus::Smbus();
+    /* Near its limits, the card goes ahead of background work such as VPD
+     * reads.
+     */
+    if (urgent)
+    {
+        bus.smbusUrgentBegin(busID);
+    }
     auto res = bus.smbusInit(busID);
-    if (res != -1)
+    if (res == -1)
+    {
+        ratelimit::error("smbusInit fail!", busID, TMP431_SLAVE_ADDR, errno);
+    }
+    /* High and low byte must come from the same conversion. A bus another
+     * service holds too long fails the read, it's retried next cycle.
+     */
+    else if (bus.smbusLock(busID) == 0)
     {
         auto exist = bus.smbusCheckSlave(busID, TMP431_SLAVE_ADDR);
         if (exist)
         {
             auto high = bus.GetSmbusCmdByte(busID, TMP431_SLAVE_ADDR, TMP431_LOCAL_HIGH_COMMAND);
             auto low = bus.GetSmbusCmdByte(busID, TMP431_SLAVE_ADDR, TMP431_LOCAL_LOW_COMMAND);
-            auto tmp = caculate(high, low);
-            setSensorValueToDbus(tmp.value);
+            bus.smbusUnlock(busID);
+            if (high >= 0 && low >= 0)
+            {
+                value = caculate(high, low).value;
+                success = true;
+            }
         }
         else
         {
-            std::cerr << "Temperature sensor not exist" <<std::endl;
+            bus.smbusUnlock(busID);
+            ratelimit::error("Temperature sensor not exist", busID,
+                             TMP431_SLAVE_ADDR, errno);
         }
     }
-    else
+    bus.smbusClose(busID);
+    if (urgent)
     {
-        std::cerr << "smbusInit fail!" << std::endl;
+        bus.smbusUrgentEnd(busID);
     }
-    bus.smbusClose(busID);
+
+    return success;
 }
 }
 }
\ No newline at end of file
@@ -1,3 +1,12 @@
+#pragma once
+
+#include "hwmon.hpp"
+
+#include <functional>
+#include <memory>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/source/io.hpp>
+#include <vector>
 #include <xyz/openbmc_project/Sensor/Value/server.hpp>
 #include <xyz/openbmc_project/Sensor/Threshold/Critical/server.hpp>
 #include <xyz/openbmc_project/Sensor/Threshold/Warning/server.hpp>
@@ -33,15 +42,83 @@ class sensor : public bittwareIfaces
     sensor& operator=(const sensor&) = delete;
     sensor(sensor&&) = delete;
     sensor& operator=(sensor&&) = delete;
-    virtual ~sensor() = default;
-    sensor(sdbusplus::bus::bus& bus, std::string path, uint8_t busID);
-    void getTemp();
-    void setSensorThreshold(uint64_t criticalHigh, uint64_t criticalLow,
-                             uint64_t maxValue, uint64_t minValue,
-                             uint64_t warningHigh, uint64_t warningLow);
+    virtual ~sensor();
+    /** @brief Constructs sensor, the object is announced on D-Bus only
+     *         once emit_object_added() is called.
+     *
+     * @param[in] backend - Whether to read through the tmp401 driver
+     */
+    sensor(sdbusplus::bus::bus& bus, std::string path, uint8_t busID,
+           const backendConfig& backend);
+    /** @brief Read the temperature and update Value
+     *
+     * @param[in] urgent - The card is near its limits, background work on
+     *                     the bus waits for the read
+     *
+     * @return true if the sensor could be read
+     */
+    bool getTemp(bool urgent = false);
+    /** @brief Set thresholds
+     *
+     * @param[in] skipSignal - Don't emit PropertiesChanged, for initial
+     *                         values set before the object is announced
+     */
+    void setSensorThreshold(int64_t criticalHigh, int64_t criticalLow,
+                             int64_t maxValue, int64_t minValue,
+                             int64_t warningHigh, int64_t warningLow,
+                             bool skipSignal = false);
+    /** @brief 2 if the last reading is within margin degrees C of
+     *         criticalHigh, 1 if within margin of warningHigh, 0 otherwise.
+     *         Thresholds left at 0 are ignored.
+     */
+    uint8_t urgency(double margin) const;
+    /** @brief Watch the max and crit alarms of the tmp401 driver, the max
+     *         limit follows warningHigh with the alarmLimits backend option.
+     *
+     * @param[in] onAlarm - Run on the event loop when an alarm changes
+     *
+     * @return false if the sensor isn't read through hwmon
+     */
+    bool watchAlarms(const sdeventplus::Event& event,
+                     std::function<void()> onAlarm);
+    /** @brief Changes smaller than deadband degrees C aren't published */
+    void setDeadband(double deadband);
     void setSensorValueToDbus(const u_int64_t value);
+    /** @brief Last reading, Value may lag it by up to the deadband */
+    int64_t lastReading() const
+    {
+        return reading;
+    }
+    /** @brief Set Value without a signal, before the object is announced */
+    void restore(int64_t value);
   private:
+    /** @brief Read the TMP431 registers through i2c-dev */
+    bool readI2C(int64_t& value, bool urgent);
+    /** @brief Publish a reading unless it's within the deadband */
+    void update(int64_t value);
     uint8_t busID;
+    /** @brief Kept open temp1_input of the tmp401 driver, -1 if unbound */
+    int hwmonFd = -1;
+    /** @brief No fallback to i2c-dev if the driver isn't bound */
+    bool hwmonOnly = false;
+    std::string sysfsRoot;
+    /** @brief Whether temp1_max follows warningHigh */
+    bool alarmLimits = false;
+    /** @brief Last temp1_max written in degrees C, 0 if none */
+    int64_t maxLimit = 0;
+    /** @brief Write a temperature limit of the tmp401 driver */
+    bool setLimit(const std::string& attr, int64_t degrees);
+    struct alarm
+    {
+        int fd;
+        std::unique_ptr<sdeventplus::source::IO> source;
+    };
+    std::vector<alarm> alarms;
+    /** @brief Deadband in Value units */
+    int64_t deadband = 0;
+    /** @brief Whether Value holds a reading yet */
+    bool valueSet = false;
+    int64_t reading = 0;
 };
 }
 }
\ No newline at end of file
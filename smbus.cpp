@@ -6,24 +6,98 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/file.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <memory>
 #include <mutex>
 
 #include "i2c-dev.h"
+#include "i2c_trace.hpp"
+#include "ratelimit.hpp"
 
-#define MAX_I2C_BUS 30
+#define MAX_I2C_BUS 256
+/* Longest adapter timeout set, in milliseconds */
+#define MAX_I2C_TIMEOUT_MS 60000
 
 static int fd[MAX_I2C_BUS] = {0};
+/* Number of smbusInit callers currently sharing fd[] of each bus */
+static int refCount[MAX_I2C_BUS] = {0};
+static std::once_flag policyInit;
+/* Lock file of each bus, -1 if the bus isn't shared with other processes */
+static int lockFd[MAX_I2C_BUS];
+static int lockDepth[MAX_I2C_BUS] = {0};
+/* Longest wait in milliseconds for the lock file of each bus */
+static int lockTimeout[MAX_I2C_BUS] = {0};
+static uint64_t lockWaitUsec[MAX_I2C_BUS] = {0};
+static uint64_t lockContended[MAX_I2C_BUS] = {0};
 
 namespace phosphor
 {
 namespace smbus
 {
 
-std::mutex gMutex;
+/* Transactions on different buses may run concurrently, a thread holding a
+ * bus for a sequence takes it again for each transaction.
+ */
+std::recursive_mutex gMutex[MAX_I2C_BUS];
+
+/* Optional transaction trace, set up before any transaction */
+static std::unique_ptr<trace::recorder> gRecorder;
+static std::unique_ptr<trace::player> gPlayer;
+
+/* Transaction counters of each bus */
+static SmbusStats gStats[MAX_I2C_BUS];
+static std::mutex gStatsMutex;
+
+/* Latency critical users pending on each bus */
+static int urgent[MAX_I2C_BUS] = {0};
+std::mutex gUrgentMutex;
+std::condition_variable gUrgentCv;
+
+void phosphor::smbus::Smbus::smbusUrgentBegin(int smbus_num)
+{
+    if (smbus_num < 0 || smbus_num >= MAX_I2C_BUS)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(gUrgentMutex);
+    urgent[smbus_num]++;
+}
+
+void phosphor::smbus::Smbus::smbusUrgentEnd(int smbus_num)
+{
+    if (smbus_num < 0 || smbus_num >= MAX_I2C_BUS)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(gUrgentMutex);
+        if (urgent[smbus_num] > 0)
+        {
+            urgent[smbus_num]--;
+        }
+    }
+    gUrgentCv.notify_all();
+}
+
+void phosphor::smbus::Smbus::smbusWaitUrgent(int smbus_num)
+{
+    if (smbus_num < 0 || smbus_num >= MAX_I2C_BUS)
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(gUrgentMutex);
+    gUrgentCv.wait(lock, [smbus_num] { return urgent[smbus_num] == 0; });
+}
 
 int phosphor::smbus::Smbus::open_i2c_dev(int i2cbus, char* filename,
                                          size_t size, int quiet)
@@ -67,46 +141,368 @@ int phosphor::smbus::Smbus::set_slave_addr(int file, int address, int force)
 {
     /* With force, let the user read from/write to the registers
        even when a driver is also running */
+    /* Callers log the failure with the bus */
     if (ioctl(file, force ? I2C_SLAVE_FORCE : I2C_SLAVE, address) < 0) {
-        fprintf(stderr,
-            "Error: Could not set address to 0x%02x: %s\n",
-            address, strerror(errno));
         return -errno;
     }
 
     return 0;
 }
 
+static void initPolicy()
+{
+    std::fill(std::begin(lockFd), std::end(lockFd), -1);
+}
+
+void phosphor::smbus::Smbus::smbusSetPolicy(int smbus_num, int timeout_ms, int retry)
+{
+    char filename[20];
+
+    if (smbus_num < 0 || smbus_num >= MAX_I2C_BUS)
+    {
+        return;
+    }
+    /* Replayed transactions never reach the device */
+    if (gPlayer || (timeout_ms < 0 && retry < 0))
+    {
+        return;
+    }
+
+    /* The settings belong to the adapter, they outlive the file */
+    int file = open_i2c_dev(smbus_num, filename, sizeof(filename), 1);
+    if (file < 0)
+    {
+        phosphor::mpSOC::ratelimit::error("Failed to open I2C bus", smbus_num,
+                                          0, errno);
+        return;
+    }
+    /* Kernel timeout unit is 10ms, round up so it's never shorter and
+     * never 0, which would time out every transfer.
+     */
+    timeout_ms = std::min(timeout_ms, MAX_I2C_TIMEOUT_MS);
+    if (timeout_ms >= 0 &&
+        ioctl(file, I2C_TIMEOUT, std::max((timeout_ms + 9) / 10, 1)) < 0)
+    {
+        phosphor::mpSOC::ratelimit::error("Failed to set I2C timeout",
+                                          smbus_num, 0, errno);
+    }
+    if (retry >= 0 && ioctl(file, I2C_RETRIES, retry) < 0)
+    {
+        phosphor::mpSOC::ratelimit::error("Failed to set I2C retries",
+                                          smbus_num, 0, errno);
+    }
+    close(file);
+}
+
+int phosphor::smbus::Smbus::smbusSetLockFile(int smbus_num, const char* path,
+                                            int timeout_ms)
+{
+    int res = 0;
+
+    if (smbus_num < 0 || smbus_num >= MAX_I2C_BUS)
+    {
+        return -EINVAL;
+    }
+
+    std::call_once(policyInit, initPolicy);
+    gMutex[smbus_num].lock();
+    if (lockFd[smbus_num] >= 0)
+    {
+        close(lockFd[smbus_num]);
+        lockFd[smbus_num] = -1;
+    }
+    lockTimeout[smbus_num] = std::max(timeout_ms, 0);
+    if (path && path[0] != '\0')
+    {
+        lockFd[smbus_num] = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lockFd[smbus_num] < 0)
+        {
+            res = -errno;
+            fprintf(stderr, "open BUS%d lock file %s failed (%s)\n", smbus_num,
+                    path, strerror(errno));
+        }
+    }
+    gMutex[smbus_num].unlock();
+
+    return res;
+}
+
+int phosphor::smbus::Smbus::smbusLock(int smbus_num)
+{
+    if (smbus_num < 0 || smbus_num >= MAX_I2C_BUS)
+    {
+        return -EINVAL;
+    }
+
+    std::call_once(policyInit, initPolicy);
+    gMutex[smbus_num].lock();
+    if (lockDepth[smbus_num]++ > 0 || lockFd[smbus_num] < 0)
+    {
+        return 0;
+    }
+
+    /* Uncontended, no clock reads on the hot path */
+    if (flock(lockFd[smbus_num], LOCK_EX | LOCK_NB) == 0)
+    {
+        return 0;
+    }
+
+    /* The caller may be the poll loop, never wait on the other service
+     * for longer than the bus allows.
+     */
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::milliseconds(lockTimeout[smbus_num]);
+    int res;
+    while ((res = flock(lockFd[smbus_num], LOCK_EX | LOCK_NB)) < 0 &&
+           (errno == EWOULDBLOCK || errno == EINTR) &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        usleep(1000);
+    }
+    auto err = errno;
+    lockWaitUsec[smbus_num] +=
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    lockContended[smbus_num]++;
+    if (res == 0)
+    {
+        return 0;
+    }
+
+    phosphor::mpSOC::ratelimit::error("Failed to lock I2C bus", smbus_num, 0,
+                                      err);
+    lockDepth[smbus_num]--;
+    gMutex[smbus_num].unlock();
+    return -EBUSY;
+}
+
+void phosphor::smbus::Smbus::smbusUnlock(int smbus_num)
+{
+    if (smbus_num < 0 || smbus_num >= MAX_I2C_BUS)
+    {
+        return;
+    }
+
+    if (--lockDepth[smbus_num] == 0 && lockFd[smbus_num] >= 0)
+    {
+        flock(lockFd[smbus_num], LOCK_UN);
+    }
+    gMutex[smbus_num].unlock();
+}
+
+uint64_t phosphor::smbus::Smbus::smbusLockWaitUsec(int smbus_num)
+{
+    if (smbus_num < 0 || smbus_num >= MAX_I2C_BUS)
+    {
+        return 0;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(gMutex[smbus_num]);
+    return lockWaitUsec[smbus_num];
+}
+
+uint64_t phosphor::smbus::Smbus::smbusLockContended(int smbus_num)
+{
+    if (smbus_num < 0 || smbus_num >= MAX_I2C_BUS)
+    {
+        return 0;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(gMutex[smbus_num]);
+    return lockContended[smbus_num];
+}
+
 int phosphor::smbus::Smbus::smbusInit(int smbus_num)
 {
     int res = 0;
     char filename[20];
 
-    gMutex.lock();
+    if (smbus_num < 0 || smbus_num >= MAX_I2C_BUS)
+    {
+        return -1;
+    }
+    /* Replayed transactions never reach the device */
+    if (gPlayer)
+    {
+        return 0;
+    }
+
+    gMutex[smbus_num].lock();
 
-    fd[smbus_num] = open_i2c_dev(smbus_num, filename, sizeof(filename), 0);
-    if (fd[smbus_num] < 0)
+    if (refCount[smbus_num] == 0)
     {
-        gMutex.unlock();
+        fd[smbus_num] = open_i2c_dev(smbus_num, filename, sizeof(filename), 1);
+        if (fd[smbus_num] < 0)
+        {
+            phosphor::mpSOC::ratelimit::error("Failed to open I2C bus",
+                                              smbus_num, 0, errno);
+            gMutex[smbus_num].unlock();
+
+            return -1;
+        }
 
-        return -1;
     }
+    refCount[smbus_num]++;
 
     res = fd[smbus_num];
 
-    gMutex.unlock();
+    gMutex[smbus_num].unlock();
 
     return res;
 }
 
 void phosphor::smbus::Smbus::smbusClose(int smbus_num)
 {
-    close(fd[smbus_num]);
+    if (smbus_num < 0 || smbus_num >= MAX_I2C_BUS || gPlayer)
+    {
+        return;
+    }
+
+    gMutex[smbus_num].lock();
+    if (refCount[smbus_num] > 0 && --refCount[smbus_num] == 0)
+    {
+        close(fd[smbus_num]);
+        fd[smbus_num] = 0;
+    }
+    gMutex[smbus_num].unlock();
 }
 
 int phosphor::smbus::Smbus::smbusSequentialRead(int smbus_num, int8_t device_addr, uint16_t length, unsigned char* buf)
 {
-    if (length > I2C_DATA_MAX)
+    return smbusSequentialRead(smbus_num, device_addr, 0, length, buf);
+}
+
+void phosphor::smbus::Smbus::smbusDone(int smbus_num, int8_t device_addr,
+                                       trace::op type, uint8_t cmd,
+                                       int result, int error,
+                                       std::chrono::steady_clock::time_point start,
+                                       const unsigned char* data,
+                                       uint16_t length)
+{
+    auto usec = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    auto bucket = std::lower_bound(std::begin(latencyBucketsUsec),
+                                   std::end(latencyBucketsUsec), usec) -
+                  std::begin(latencyBucketsUsec);
+
+    if (smbus_num >= 0 && smbus_num < MAX_I2C_BUS)
+    {
+        std::lock_guard<std::mutex> lock(gStatsMutex);
+        auto& stats = gStats[smbus_num];
+        stats.transactions++;
+        if (result < 0)
+        {
+            stats.errors++;
+            /* i2c-dev reports a missing ACK as ENXIO or EREMOTEIO */
+            if (error == ENXIO || error == EREMOTEIO)
+            {
+                stats.naks++;
+            }
+        }
+        stats.latency[bucket]++;
+        stats.latencySumUsec += usec;
+    }
+
+    if (gRecorder)
+    {
+        gRecorder->add(smbus_num, device_addr, type, cmd, result, error, start,
+                       data, length);
+    }
+}
+
+phosphor::smbus::SmbusStats
+    phosphor::smbus::Smbus::smbusGetStats(int smbus_num)
+{
+    if (smbus_num < 0 || smbus_num >= MAX_I2C_BUS)
+    {
+        return SmbusStats();
+    }
+
+    std::lock_guard<std::mutex> lock(gStatsMutex);
+    return gStats[smbus_num];
+}
+
+/* Random read at offset followed by current address reads, the bus is only
+ * held for length bytes so a long dump can be split into several calls.
+ */
+int phosphor::smbus::Smbus::smbusSequentialRead(int smbus_num, int8_t device_addr, uint8_t offset, uint16_t length, unsigned char* buf)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto res = gPlayer ? gPlayer->transfer(smbus_num, device_addr,
+                                           trace::op::sequentialRead, offset,
+                                           buf, length)
+                       : devSequentialRead(smbus_num, device_addr, offset,
+                                           length, buf);
+    smbusDone(smbus_num, device_addr, trace::op::sequentialRead, offset, res,
+              errno, start, (res > 0) ? buf : nullptr, (res > 0) ? res : 0);
+    return res;
+}
+
+bool phosphor::smbus::Smbus::smbusCheckSlave(int smbus_num, int8_t device_addr)
+{
+    auto start = std::chrono::steady_clock::now();
+    /* Result 1 for an ACK, -1 for no device */
+    auto res = gPlayer ? gPlayer->transfer(smbus_num, device_addr,
+                                           trace::op::quick, 0, nullptr, 0)
+                       : (devCheckSlave(smbus_num, device_addr) ? 1 : -1);
+    smbusDone(smbus_num, device_addr, trace::op::quick, 0, res, errno, start,
+              nullptr, 0);
+    return res > 0;
+}
+
+int phosphor::smbus::Smbus::GetSmbusCmdByte(int smbus_num, int8_t device_addr, int8_t smbuscmd)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto res = gPlayer ? gPlayer->transfer(smbus_num, device_addr,
+                                           trace::op::readByte, smbuscmd,
+                                           nullptr, 0)
+                       : devGetSmbusCmdByte(smbus_num, device_addr, smbuscmd);
+    smbusDone(smbus_num, device_addr, trace::op::readByte, smbuscmd, res,
+              errno, start, nullptr, 0);
+    return res;
+}
+
+int phosphor::smbus::Smbus::SetSmbusCmdByte(int smbus_num, int8_t device_addr, int8_t smbuscmd , int8_t data)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto res = gPlayer ? gPlayer->transfer(smbus_num, device_addr,
+                                           trace::op::writeByte, smbuscmd,
+                                           nullptr, 0)
+                       : devSetSmbusCmdByte(smbus_num, device_addr, smbuscmd,
+                                            data);
+    auto byte = static_cast<unsigned char>(data);
+    smbusDone(smbus_num, device_addr, trace::op::writeByte, smbuscmd, res,
+              errno, start, &byte, 1);
+    return res;
+}
+
+int phosphor::smbus::Smbus::smbusRecord(const char* path)
+{
+    auto rec = std::make_unique<trace::recorder>(path);
+    if (!rec->ready())
+    {
+        return -1;
+    }
+    gRecorder = std::move(rec);
+    return 0;
+}
+
+int phosphor::smbus::Smbus::smbusReplay(const char* path, int speed)
+{
+    auto play = std::make_unique<trace::player>(path, speed);
+    if (!play->ready())
+    {
+        return -1;
+    }
+    gPlayer = std::move(play);
+    return 0;
+}
+
+int phosphor::smbus::Smbus::devSequentialRead(int smbus_num, int8_t device_addr, uint8_t offset, uint16_t length, unsigned char* buf)
+{
+    if (offset + length > I2C_DATA_MAX)
     {
         fprintf(stderr, "length is over restriction\n");
         return -1;
@@ -115,21 +511,24 @@ int phosphor::smbus::Smbus::smbusSequentialRead(int smbus_num, int8_t device_add
     int res;
     uint16_t byte_read = 0;
 
-    gMutex.lock();
+    if (smbusLock(smbus_num) < 0)
+    {
+        errno = EBUSY;
+        return -1;
+    }
     if(fd[smbus_num] > 0) {
         res = set_slave_addr(fd[smbus_num], device_addr, I2C_SLAVE_FORCE);
         if(res < 0) {
-            fprintf(stderr, "set PMBUS BUS%d to slave address 0x%02X failed (%s)\n", smbus_num, device_addr,strerror(errno));
-                close(fd[smbus_num]);
+            phosphor::mpSOC::ratelimit::error("Failed to set I2C slave address", smbus_num, device_addr, errno);
 
-                gMutex.unlock();
+                smbusUnlock(smbus_num);
             return -1;
         }
     }
     
-    res = i2c_smbus_read_byte_data(fd[smbus_num], 0);
+    res = i2c_smbus_read_byte_data(fd[smbus_num], offset);
     if (res < 0) {
-        gMutex.unlock();
+        smbusUnlock(smbus_num);
         return -1;
     }
     buf[0] = res;
@@ -137,28 +536,31 @@ int phosphor::smbus::Smbus::smbusSequentialRead(int smbus_num, int8_t device_add
     for (byte_read = 1; byte_read < length; byte_read++) {
         res = i2c_smbus_read_byte(fd[smbus_num]);
         if (res < 0) {
-            gMutex.unlock();
+            smbusUnlock(smbus_num);
             return -1;
         }
         buf[byte_read] = res;
     }
 
-    gMutex.unlock();
+    smbusUnlock(smbus_num);
     return byte_read;
 }
 
-bool phosphor::smbus::Smbus::smbusCheckSlave(int smbus_num, int8_t device_addr)
+bool phosphor::smbus::Smbus::devCheckSlave(int smbus_num, int8_t device_addr)
 {
     int res;
 
-    gMutex.lock();
+    if (smbusLock(smbus_num) < 0)
+    {
+        errno = EBUSY;
+        return false;
+    }
     if(fd[smbus_num] > 0) {
         res = set_slave_addr(fd[smbus_num], device_addr, I2C_SLAVE_FORCE);
         if(res < 0) {
-            fprintf(stderr, "set PMBUS BUS%d to slave address 0x%02X failed (%s)\n", smbus_num, device_addr,strerror(errno));
-                close(fd[smbus_num]);
+            phosphor::mpSOC::ratelimit::error("Failed to set I2C slave address", smbus_num, device_addr, errno);
 
-                gMutex.unlock();
+                smbusUnlock(smbus_num);
             return false;
         }
     }
@@ -166,28 +568,31 @@ bool phosphor::smbus::Smbus::smbusCheckSlave(int smbus_num, int8_t device_addr)
     res = i2c_smbus_write_quick(fd[smbus_num], I2C_SMBUS_WRITE);
     if (res < 0) {
         //fprintf(stderr, "Error: Read failed\n");
-        gMutex.unlock();
+        smbusUnlock(smbus_num);
 
         return false;
     }
     // printf("[SetSmbusCmdByte]0x%0*x\n",2, res);
 
-    gMutex.unlock();
+    smbusUnlock(smbus_num);
     return true;
 }
 
-int phosphor::smbus::Smbus::GetSmbusCmdByte(int smbus_num, int8_t device_addr, int8_t smbuscmd)
+int phosphor::smbus::Smbus::devGetSmbusCmdByte(int smbus_num, int8_t device_addr, int8_t smbuscmd)
 {
     int res;
 
-    gMutex.lock();
+    if (smbusLock(smbus_num) < 0)
+    {
+        errno = EBUSY;
+        return -1;
+    }
     if(fd[smbus_num] > 0) {
         res = set_slave_addr(fd[smbus_num], device_addr, I2C_SLAVE_FORCE);
         if(res < 0) {
-            fprintf(stderr, "set PMBUS BUS%d to slave address 0x%02X failed (%s)\n", smbus_num, device_addr,strerror(errno));
-                close(fd[smbus_num]);
+            phosphor::mpSOC::ratelimit::error("Failed to set I2C slave address", smbus_num, device_addr, errno);
 
-                gMutex.unlock();
+                smbusUnlock(smbus_num);
             return -1;
         }
     }
@@ -195,28 +600,31 @@ int phosphor::smbus::Smbus::GetSmbusCmdByte(int smbus_num, int8_t device_addr, i
     res = i2c_smbus_read_byte_data(fd[smbus_num], smbuscmd);
     if (res < 0) {
         //fprintf(stderr, "Error: Read failed\n");
-        gMutex.unlock();
+        smbusUnlock(smbus_num);
 
         return -1;
     }
     // printf("[SetSmbusCmdByte]0x%0*x\n",2, res);
 
-    gMutex.unlock();
+    smbusUnlock(smbus_num);
     return res;
 }
 
-int phosphor::smbus::Smbus::SetSmbusCmdByte(int smbus_num, int8_t device_addr, int8_t smbuscmd , int8_t data)
+int phosphor::smbus::Smbus::devSetSmbusCmdByte(int smbus_num, int8_t device_addr, int8_t smbuscmd , int8_t data)
 {
     int res;
 
-    gMutex.lock();
+    if (smbusLock(smbus_num) < 0)
+    {
+        errno = EBUSY;
+        return -1;
+    }
     if(fd[smbus_num] > 0) {
         res = set_slave_addr(fd[smbus_num], device_addr, I2C_SLAVE_FORCE);
         if(res < 0) {
-            fprintf(stderr, "set PMBUS BUS%d to slave address 0x%02X failed (%s)\n", smbus_num, device_addr,strerror(errno));
-                close(fd[smbus_num]);
+            phosphor::mpSOC::ratelimit::error("Failed to set I2C slave address", smbus_num, device_addr, errno);
 
-                gMutex.unlock();
+                smbusUnlock(smbus_num);
             return -1;
         }
     }
@@ -224,13 +632,13 @@ int phosphor::smbus::Smbus::SetSmbusCmdByte(int smbus_num, int8_t device_addr, i
     res = i2c_smbus_write_byte_data(fd[smbus_num], smbuscmd, data);
     if (res < 0) {
         //fprintf(stderr, "Error: Read failed\n");
-        gMutex.unlock();
+        smbusUnlock(smbus_num);
 
         return -1;
     }
     // printf("[SetSmbusCmdByte]0x%0*x\n",2, res);
 
-    gMutex.unlock();
+    smbusUnlock(smbus_num);
     return res;
 }
 
@@ -245,7 +653,11 @@ int phosphor::smbus::Smbus::SendSmbusRWBlockCmdRAW(int smbus_num,
 
     Rx_buf[0] = 1;
 
-    gMutex.lock();
+    if (smbusLock(smbus_num) < 0)
+    {
+        errno = EBUSY;
+        return -1;
+    }
 
     res = i2c_read_after_write(fd[smbus_num], 0, device_addr, tx_len,
                                (unsigned char*)tx_data, I2C_DATA_MAX,
@@ -260,7 +672,7 @@ int phosphor::smbus::Smbus::SendSmbusRWBlockCmdRAW(int smbus_num,
 
     memcpy(rsp_data, Rx_buf, res_len);
 
-    gMutex.unlock();
+    smbusUnlock(smbus_num);
 
     return res;
 }
@@ -9,13 +9,35 @@
 #include <sys/ioctl.h>
 #include <unistd.h>
 
+#include <chrono>
+
 #include "i2c-dev.h"
+#include "i2c_trace.hpp"
 
 namespace phosphor
 {
 namespace smbus
 {
 
+/* Upper bounds in microseconds of the transaction latency buckets, the
+ * last bucket counts the slower ones.
+ */
+constexpr uint32_t latencyBucketsUsec[] = {100,  200,   500,   1000,  2000,
+                                           5000, 10000, 20000, 50000, 100000};
+constexpr size_t latencyBuckets = sizeof(latencyBucketsUsec) / sizeof(uint32_t);
+
+/* Transaction counters of a bus */
+struct SmbusStats
+{
+    uint64_t transactions = 0;
+    /* Failed transactions, NAKs included */
+    uint64_t errors = 0;
+    /* Transactions the device didn't acknowledge */
+    uint64_t naks = 0;
+    uint64_t latency[latencyBuckets + 1] = {0};
+    uint64_t latencySumUsec = 0;
+};
+
 class Smbus
 {
   public:
@@ -27,19 +49,86 @@ class Smbus
 
     int smbusInit(int smbus_num);
 
+    /* Set the adapter timeout (ms) and retries of a root adapter, mux
+     * channels transfer through their parent and use its settings. -1
+     * leaves the kernel setting untouched.
+     */
+    void smbusSetPolicy(int smbus_num, int timeout_ms, int retries);
+
+    /* Advisory lock file shared with other services using the bus, NULL or
+     * an empty path disables it. smbusLock() gives up after timeout_ms.
+     * Returns 0 or -errno.
+     */
+    int smbusSetLockFile(int smbus_num, const char* path, int timeout_ms);
+
     void smbusClose(int smbus_num);
 
+    /* Hold the bus for a sequence of transactions, nestable. The lock file
+     * is flock()ed while the outermost hold lasts. Returns 0, or -EBUSY if
+     * another service kept the lock file past the timeout, then the bus
+     * isn't held and smbusUnlock() mustn't be called.
+     */
+    int smbusLock(int smbus_num);
+
+    void smbusUnlock(int smbus_num);
+
+    /* Time spent waiting for other processes to release the lock file and
+     * number of acquisitions that had to wait.
+     */
+    uint64_t smbusLockWaitUsec(int smbus_num);
+
+    uint64_t smbusLockContended(int smbus_num);
+
+    /* Counters of the transactions made on the bus, replayed ones included */
+    SmbusStats smbusGetStats(int smbus_num);
+
     int smbusSequentialRead(int smbus_num, int8_t device_addr, uint16_t length, unsigned char* buf);
 
+    int smbusSequentialRead(int smbus_num, int8_t device_addr, uint8_t offset, uint16_t length, unsigned char* buf);
+
     int GetSmbusCmdByte(int smbus_num, int8_t device_addr, int8_t smbuscmd);
 
     bool smbusCheckSlave(int smbus_num, int8_t device_addr);
 
     int SetSmbusCmdByte(int smbus_num, int8_t device_addr, int8_t smbuscmd , int8_t data);
 
+    /* Latency critical work on a bus, background work waits for it */
+    void smbusUrgentBegin(int smbus_num);
+
+    void smbusUrgentEnd(int smbus_num);
+
+    /* Called by background work before each bus transaction sequence */
+    void smbusWaitUrgent(int smbus_num);
+
     int SendSmbusRWBlockCmdRAW(int smbus_num, int8_t device_addr,
                                uint8_t* tx_data, uint8_t tx_len,
                                uint8_t* rsp_data);
+
+    /* Append every transaction to a binary trace, see i2c_trace.hpp. Call
+     * before the first transaction. Returns 0 or -1.
+     */
+    int smbusRecord(const char* path);
+
+    /* Answer transactions from a trace instead of the buses, latencies
+     * divided by speed, 0 for none. Call before the first transaction.
+     * Returns 0 or -1.
+     */
+    int smbusReplay(const char* path, int speed);
+
+  private:
+    /* Account a finished transaction and append it to the trace */
+    void smbusDone(int smbus_num, int8_t device_addr, trace::op type,
+                   uint8_t cmd, int result, int error,
+                   std::chrono::steady_clock::time_point start,
+                   const unsigned char* data, uint16_t length);
+
+    int devSequentialRead(int smbus_num, int8_t device_addr, uint8_t offset, uint16_t length, unsigned char* buf);
+
+    bool devCheckSlave(int smbus_num, int8_t device_addr);
+
+    int devGetSmbusCmdByte(int smbus_num, int8_t device_addr, int8_t smbuscmd);
+
+    int devSetSmbusCmdByte(int smbus_num, int8_t device_addr, int8_t smbuscmd , int8_t data);
 };
 
 } // namespace smbus
@@ -0,0 +1,108 @@
+#include "telemetry.hpp"
+
+#include "readings.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+namespace telemetry
+{
+writer::writer(const std::string& path) : path(path)
+{
+    auto dir = path.substr(0, path.find_last_of('/'));
+    if (!dir.empty() && mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST)
+    {
+        std::cerr << "Failed to create " << dir << ": " << strerror(errno)
+                  << std::endl;
+        return;
+    }
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to open " << path << ": " << strerror(errno)
+                  << std::endl;
+        return;
+    }
+    if (ftruncate(fd, sizeof(region)) < 0)
+    {
+        std::cerr << "Failed to size " << path << ": " << strerror(errno)
+                  << std::endl;
+        close(fd);
+        return;
+    }
+
+    auto addr = mmap(nullptr, sizeof(region), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        std::cerr << "Failed to map " << path << ": " << strerror(errno)
+                  << std::endl;
+        return;
+    }
+    r = static_cast<region*>(addr);
+
+    /* Leave an odd sequence while the header is rewritten, readers of a
+     * previous instance's file back off until it's consistent again.
+     */
+    auto seq = r->hdr.sequence.load(std::memory_order_relaxed) | 1;
+    r->hdr.sequence.store(seq, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    r->hdr.magic = magic;
+    r->hdr.version = version;
+    r->hdr.cardSize = sizeof(card);
+    r->hdr.maxCards = maxCards;
+    r->hdr.cardCount = 0;
+    r->hdr.sequence.store(seq + 1, std::memory_order_release);
+}
+
+writer::~writer()
+{
+    if (r)
+    {
+        munmap(r, sizeof(region));
+    }
+}
+
+void writer::update(const std::vector<cardReading>& readings)
+{
+    if (!r)
+    {
+        return;
+    }
+
+    auto seq = r->hdr.sequence.load(std::memory_order_relaxed);
+    r->hdr.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t count = 0;
+    for (const auto& reading : readings)
+    {
+        if (count >= maxCards)
+        {
+            break;
+        }
+        card c{};
+        c.index = reading.index;
+        c.present = reading.present;
+        c.functional = reading.functional;
+        c.value = reading.value;
+        c.timestamp = reading.timestamp;
+        std::memcpy(&r->cards[count++], &c, sizeof(c));
+    }
+    r->hdr.cardCount = count;
+
+    r->hdr.sequence.store(seq + 2, std::memory_order_release);
+}
+}
+}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+struct cardReading;
+
+namespace telemetry
+{
+constexpr uint32_t magic = 0x4d545742; /* "BWTM" */
+constexpr uint16_t version = 1;
+/** @brief Card index is 8 bits, so are the slots of the region */
+constexpr uint32_t maxCards = 256;
+
+/** @brief Fixed binary layout of one card, little endian */
+struct card
+{
+    uint8_t index;
+    uint8_t present;
+    uint8_t functional;
+    uint8_t reserved[5];
+    /** @brief Temperature, same unit and scale as Sensor.Value */
+    int64_t value;
+    /** @brief Microseconds since epoch of the last successful read */
+    uint64_t timestamp;
+};
+static_assert(sizeof(card) == 24, "telemetry card layout changed");
+
+/** @brief Fixed binary layout of the region header
+ *
+ *  sequence is odd while the daemon updates the cards, readers retry until
+ *  they copied the cards between two reads of the same even sequence.
+ */
+struct header
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t cardSize;
+    uint32_t maxCards;
+    uint32_t cardCount;
+    std::atomic<uint64_t> sequence;
+};
+static_assert(sizeof(header) == 24, "telemetry header layout changed");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "telemetry sequence must be lock free");
+
+struct region
+{
+    header hdr;
+    card cards[maxCards];
+};
+
+/** @brief Copy a consistent snapshot out of a mapped region, for consumers
+ *
+ * @param[in] r      - Region mapped read-only from the telemetry file
+ * @param[out] cards - Cards of the snapshot
+ *
+ * @return false if the region isn't a telemetry region of this version
+ */
+inline bool readSnapshot(const region* r, std::vector<card>& cards)
+{
+    if (r->hdr.magic != magic || r->hdr.version != version ||
+        r->hdr.cardSize != sizeof(card))
+    {
+        return false;
+    }
+
+    uint64_t before, after;
+    do
+    {
+        before = r->hdr.sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            continue;
+        }
+        auto count = std::min(r->hdr.cardCount, maxCards);
+        cards.resize(count);
+        std::memcpy(cards.data(), r->cards, count * sizeof(card));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = r->hdr.sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    return true;
+}
+
+/** @class writer
+ *  @brief Publishes the readings of every card into a shared memory file.
+ */
+class writer
+{
+  public:
+    writer() = delete;
+    writer(const writer&) = delete;
+    writer& operator=(const writer&) = delete;
+    writer(writer&&) = delete;
+    writer& operator=(writer&&) = delete;
+    ~writer();
+
+    /** @brief Create or reuse the telemetry file and map it
+     *
+     * @param[in] path - File to map, its directory is created if missing
+     */
+    explicit writer(const std::string& path);
+
+    /** @brief Whether the region is mapped and update() publishes */
+    bool ready() const
+    {
+        return r != nullptr;
+    }
+
+    /** @brief Publish the readings of one poll cycle */
+    void update(const std::vector<cardReading>& readings);
+
+  private:
+    std::string path;
+    region* r = nullptr;
+};
+}
+}
+}
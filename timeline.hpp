@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace mpSOC
+{
+/** @class timeline
+ *  @brief Records when each startup phase of each card ran.
+ *
+ *  Phases may be recorded from any thread, the timeline is dumped once
+ *  every card has been brought up.
+ */
+class timeline
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    struct phase
+    {
+        int card;
+        std::string name;
+        clock::time_point start;
+        clock::time_point end;
+    };
+
+    /** @class scope
+     *  @brief Records a phase lasting for the lifetime of this object.
+     */
+    class scope
+    {
+      public:
+        scope(timeline& t, int card, const std::string& name) :
+            t(t), card(card), name(name), start(clock::now())
+        {
+        }
+        ~scope()
+        {
+            t.record(card, name, start, clock::now());
+        }
+
+      private:
+        timeline& t;
+        int card;
+        std::string name;
+        clock::time_point start;
+    };
+
+    timeline() : origin(clock::now())
+    {
+    }
+
+    void record(int card, const std::string& name, clock::time_point start,
+                clock::time_point end)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        phases.push_back({card, name, start, end});
+    }
+
+    std::vector<phase> get() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return phases;
+    }
+
+    /** @brief Milliseconds elapsed between timeline creation and t */
+    int64_t offset(clock::time_point t) const
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(t -
+                                                                     origin)
+            .count();
+    }
+
+    /** @brief Print every phase as "card phase start +duration" in ms */
+    void dump(std::ostream& os) const
+    {
+        for (const auto& p : get())
+        {
+            os << "Startup timeline: Bittware " << p.card << " " << p.name
+               << " at " << offset(p.start) << "ms took "
+               << offset(p.end) - offset(p.start) << "ms" << std::endl;
+        }
+    }
+
+  private:
+    clock::time_point origin;
+    mutable std::mutex mutex;
+    std::vector<phase> phases;
+};
+}
+}
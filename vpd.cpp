@@ -20,6 +20,11 @@
 #define PCI_VPD_KEYWORD_LEN 2
 #define PCI_VPD_HEADER_LEN 3
 
+/* Bytes dumped per bus acquisition, pending temperature reads of the bus
+ * go first between chunks.
+ */
+#define VPD_READ_CHUNK 32
+
 namespace phosphor
 {
 namespace mpSOC
@@ -30,26 +35,62 @@ vpd::vpd() :
     vpdData.clear();
 }
 
-vpd::vpd(uint8_t busID, uint8_t eepromAddr) :
-    busID(busID), eepromAddr(eepromAddr), idChecked(false),
+vpd::vpd(uint8_t busID, uint8_t eepromAddr, const backendConfig& backend) :
+    backend(backend), busID(busID), eepromAddr(eepromAddr), idChecked(false),
     checksumVerified(false)
 {
     read();
     parse();
 }
 
+bool vpd::readNvmem()
+{
+    unsigned char buf[I2C_DATA_MAX] = {0};
+
+    auto res = hwmon::readNvmem(backend.sysfsRoot, busID, eepromAddr, buf,
+                                sizeof(buf));
+    if (res <= 0)
+    {
+        return false;
+    }
+    std::move(std::begin(buf), std::end(buf), rawData.begin());
+    return true;
+}
+
 void vpd::read()
 {
     unsigned char buf[I2C_DATA_MAX] = {0};
 
+    if (backend.mode != backendConfig::type::i2cdev)
+    {
+        if (readNvmem())
+        {
+            return;
+        }
+        if (backend.mode == backendConfig::type::hwmon)
+        {
+            std::cerr << "Read VPD data through nvmem failed" << std::endl;
+            return;
+        }
+    }
+
     auto bus = phosphor::smbus::Smbus();
     auto res = bus.smbusInit(busID);
     if (res != -1)
     {
         /* Dump all data from eeprom, for detail, please refer to atmel-8719 datasheet,
-         * Sequential Read section.
+         * Random Read and Sequential Read section.
          */
-        res = bus.smbusSequentialRead(busID, eepromAddr, I2C_DATA_MAX, buf);
+        for (int offset = 0; offset < I2C_DATA_MAX; offset += VPD_READ_CHUNK)
+        {
+            bus.smbusWaitUrgent(busID);
+            res = bus.smbusSequentialRead(busID, eepromAddr, offset,
+                                          VPD_READ_CHUNK, buf + offset);
+            if (res < 0)
+            {
+                break;
+            }
+        }
         if (res < 0) {
             std::cerr << "Read VPD data failed" << std::endl;
         }
@@ -66,6 +107,43 @@ void vpd::read()
     bus.smbusClose(busID);
 }
 
+bool vpd::verify(uint8_t busID, uint8_t eepromAddr,
+                 const backendConfig& backend, const vpdFingerprint& expected)
+{
+    unsigned char buf[I2C_DATA_MAX] = {0};
+    size_t end = expected.offset + expected.length;
+
+    if (expected.length == 0 || end > sizeof(buf))
+    {
+        return false;
+    }
+
+    if (backend.mode != backendConfig::type::i2cdev)
+    {
+        auto res = hwmon::readNvmem(backend.sysfsRoot, busID, eepromAddr, buf,
+                                    end);
+        if (res >= 0 || backend.mode == backendConfig::type::hwmon)
+        {
+            return res == static_cast<int>(end) &&
+                   checkpoint::hash(buf + expected.offset, expected.length) ==
+                       expected.hash;
+        }
+    }
+
+    auto bus = phosphor::smbus::Smbus();
+    auto res = bus.smbusInit(busID);
+    if (res != -1)
+    {
+        bus.smbusWaitUrgent(busID);
+        res = bus.smbusSequentialRead(busID, eepromAddr, expected.offset,
+                                      expected.length, buf);
+    }
+    bus.smbusClose(busID);
+
+    return res >= 0 &&
+           checkpoint::hash(buf, expected.length) == expected.hash;
+}
+
 static inline uint8_t caculateLRDT(uint8_t lrdt)
 {
 	return (lrdt & PCI_VPD_LRDT_TIN_MASK);
@@ -116,6 +194,7 @@ bool vpd::parseField(const uint8_t fieldOffset, uint8_t& nextField)
             {
                 std::cerr << "Invalid VPD data, checksum incorrect." << std::endl;
                 vpdData.clear();
+                serial = vpdFingerprint();
             }
             return false;
         }
@@ -172,6 +251,13 @@ bool vpd::parseField(const uint8_t fieldOffset, uint8_t& nextField)
                     {
                         verifyChecksum(dataOffset + PCI_VPD_HEADER_LEN);
                     }
+                    if (keyword.compare("SN") == 0)
+                    {
+                        serial.offset = dataOffset;
+                        serial.length = dataLen + PCI_VPD_HEADER_LEN;
+                        serial.hash = checkpoint::hash(
+                            rawData.data() + dataOffset, serial.length);
+                    }
                     dataOffset += dataLen + PCI_VPD_HEADER_LEN;
                     byteRead += dataLen + PCI_VPD_HEADER_LEN;
                     vpdData.insert(std::pair<std::string, std::string>(keyword, data));
@@ -1,3 +1,7 @@
+#pragma once
+
+#include "checkpoint.hpp"
+#include "hwmon.hpp"
 #include "smbus.hpp"
 
 #include <string>
@@ -12,7 +16,11 @@ class vpd
 {
   public:
     vpd();
-    vpd(uint8_t busID, uint8_t eepromAddr);
+    /** @brief Read and parse the VPD of a card
+     *
+     * @param[in] backend - Whether to read through the at24 driver
+     */
+    vpd(uint8_t busID, uint8_t eepromAddr, const backendConfig& backend);
     vpd(const vpd&) = delete;
     vpd& operator=(const vpd&) = delete;
     vpd(vpd&&) = delete;
@@ -22,13 +30,33 @@ class vpd
     void verifyChecksum(uint8_t offset);
     void read();
     void parse();
+    /** @brief Fingerprint of the serial number read by parse() */
+    vpdFingerprint fingerprint() const
+    {
+        return serial;
+    }
+    /** @brief Check that the EEPROM still holds the VPD of a fingerprint,
+     *         only the serial number bytes are read.
+     *
+     * @return false on mismatch, read failure or an empty fingerprint
+     */
+    static bool verify(uint8_t busID, uint8_t eepromAddr,
+                       const backendConfig& backend,
+                       const vpdFingerprint& expected);
   private:
+    /** @brief Read the EEPROM through the at24 nvmem file
+     *
+     * @return false if the driver isn't bound or the read failed
+     */
+    bool readNvmem();
+    backendConfig backend;
     bool parseField(const uint8_t fieldOffset, uint8_t& nextField);
     std::array<unsigned char, I2C_DATA_MAX> rawData;
     uint8_t eepromAddr;
     bool idChecked;
     bool checksumVerified;
     uint8_t busID;
+    vpdFingerprint serial;
 };
 }
 }
\ No newline at end of file